@@ -0,0 +1,170 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "account.h"
+
+// whether every pipeline is reported, set with SHELL_TIME
+int accountingEnabled = 0;
+
+// read the accounting mode from the environment
+void initAccounting() {
+    char *mode = getenv("SHELL_TIME");
+    accountingEnabled = mode != NULL && mode[0] != '\0' && strcmp(mode, "0") != 0;
+}
+
+// check if every pipeline is reported
+int isAccountingEnabled() {
+    return accountingEnabled;
+}
+
+// get the seconds between two times
+double elapsedSeconds(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// get the seconds of a rusage time
+double timevalSeconds(struct timeval *time) {
+    return time->tv_sec + time->tv_usec / 1e6;
+}
+
+// start measuring a pipeline before its stages are launched
+void startPipelineUsage(PipelineUsage *usage, int numStages) {
+    usage->stages = calloc(numStages, sizeof(StageUsage));
+    usage->numStages = numStages;
+    for (int i = 0; i < numStages; i++) {
+        usage->stages[i].pid = -1;
+        usage->stages[i].pidfd = -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &usage->startTime);
+}
+
+// remember a launched stage, a pid below 0 means it could not be launched and 0 that it ran in the shell
+void startStageUsage(PipelineUsage *usage, int index, pid_t pid, char *name) {
+    StageUsage *stage = &usage->stages[index];
+    stage->pid = pid;
+    stage->name = name;
+    clock_gettime(CLOCK_MONOTONIC, &stage->startTime);
+    stage->endTime = stage->startTime;
+    // stages that could not start or ran in the shell have nothing to wait for
+    stage->collected = pid <= 0;
+    if (pid > 0) {
+        stage->pidfd = syscall(SYS_pidfd_open, pid, 0);
+    }
+}
+
+// collect a stage and the resources it used
+void collectStageUsage(StageUsage *stage) {
+    while (wait4(stage->pid, &stage->status, 0, &stage->usage) < 0 && errno == EINTR);
+    clock_gettime(CLOCK_MONOTONIC, &stage->endTime);
+    stage->collected = 1;
+    if (stage->pidfd >= 0) {
+        close(stage->pidfd);
+        stage->pidfd = -1;
+    }
+}
+
+// add the pidfds of the stages that still run to the fds of a poll, returns how many were added;
+// fds has room for every stage
+int addStageWatches(PipelineUsage *usage, struct pollfd *fds) {
+    int numFds = 0;
+    for (int i = 0; i < usage->numStages; i++) {
+        if (usage->stages[i].pidfd >= 0) {
+            fds[numFds].fd = usage->stages[i].pidfd;
+            fds[numFds].events = POLLIN;
+            fds[numFds].revents = 0;
+            numFds++;
+        }
+    }
+    return numFds;
+}
+
+// collect the stages whose pidfds were readable in a poll, so their wall time ends when they exit
+void collectExitedStages(PipelineUsage *usage, struct pollfd *fds, int numFds) {
+    for (int i = 0; i < numFds; i++) {
+        if (fds[i].revents == 0) {
+            continue;
+        }
+        for (int j = 0; j < usage->numStages; j++) {
+            if (usage->stages[j].pidfd == fds[i].fd) {
+                collectStageUsage(&usage->stages[j]);
+                break;
+            }
+        }
+    }
+}
+
+// wait for the stages that were not collected yet, in the order they finish so every stage gets its
+// own wall time; the time limit, if there is one, is watched meanwhile
+void waitPipelineUsage(PipelineUsage *usage, Deadline *deadline) {
+    // without pidfds the stages are collected in order
+    for (int i = 0; i < usage->numStages; i++) {
+        if (!usage->stages[i].collected && usage->stages[i].pidfd < 0) {
+            collectStageUsage(&usage->stages[i]);
+        }
+    }
+    struct pollfd *fds = malloc((usage->numStages + 1) * sizeof(struct pollfd));
+    int numFds;
+    while ((numFds = addStageWatches(usage, fds)) > 0) {
+        fds[numFds].fd = deadline != NULL && !deadline->expired ? deadline->timer : -1;
+        fds[numFds].events = POLLIN;
+        fds[numFds].revents = 0;
+        if (poll(fds, numFds + 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (deadline != NULL) {
+            checkDeadline(deadline);
+        }
+        collectExitedStages(usage, fds, numFds);
+    }
+    // collect anything left if poll failed
+    for (int i = 0; i < usage->numStages; i++) {
+        if (!usage->stages[i].collected) {
+            collectStageUsage(&usage->stages[i]);
+        }
+    }
+    free(fds);
+    clock_gettime(CLOCK_MONOTONIC, &usage->endTime);
+}
+
+// report the resources of every stage on stderr
+void reportPipelineUsage(PipelineUsage *usage) {
+    double user = 0;
+    double system = 0;
+    fprintf(stderr, "%-6s %10s %10s %10s %10s %8s %8s  %s\n",
+        "stage", "real", "user", "sys", "maxrss", "vcsw", "ivcsw", "command");
+    for (int i = 0; i < usage->numStages; i++) {
+        StageUsage *stage = &usage->stages[i];
+        if (stage->pid <= 0) {
+            fprintf(stderr, "%-6d %10s %10s %10s %10s %8s %8s  %s\n", i + 1, "-", "-", "-", "-", "-", "-", stage->name);
+            continue;
+        }
+        user += timevalSeconds(&stage->usage.ru_utime);
+        system += timevalSeconds(&stage->usage.ru_stime);
+        fprintf(stderr, "%-6d %9.3fs %9.3fs %9.3fs %7ld KB %8ld %8ld  %s\n", i + 1,
+            elapsedSeconds(&stage->startTime, &stage->endTime),
+            timevalSeconds(&stage->usage.ru_utime), timevalSeconds(&stage->usage.ru_stime),
+            stage->usage.ru_maxrss, stage->usage.ru_nvcsw, stage->usage.ru_nivcsw, stage->name);
+    }
+    fprintf(stderr, "%-6s %9.3fs %9.3fs %9.3fs\n", "total", elapsedSeconds(&usage->startTime, &usage->endTime), user, system);
+}
+
+// free the stages of a pipeline
+void freePipelineUsage(PipelineUsage *usage) {
+    for (int i = 0; i < usage->numStages; i++) {
+        if (usage->stages[i].pidfd >= 0) {
+            close(usage->stages[i].pidfd);
+        }
+    }
+    free(usage->stages);
+    usage->stages = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef ACCOUNT_H
+#define ACCOUNT_H
+
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/resource.h>
+
+#include "deadline.h"
+
+// structure for the resources used by one stage of a pipeline
+typedef struct StageUsage {
+    pid_t pid;
+    char *name;
+    int status;
+    struct timespec startTime;
+    struct timespec endTime;
+    struct rusage usage;
+    // readable when the stage exits, -1 once it is collected or if it has none
+    int pidfd;
+    int collected;
+} StageUsage;
+
+// structure for the resources used by a pipeline
+typedef struct PipelineUsage {
+    StageUsage *stages;
+    int numStages;
+    struct timespec startTime;
+    struct timespec endTime;
+} PipelineUsage;
+
+void initAccounting();
+int isAccountingEnabled();
+void startPipelineUsage(PipelineUsage *usage, int numStages);
+void startStageUsage(PipelineUsage *usage, int index, pid_t pid, char *name);
+int addStageWatches(PipelineUsage *usage, struct pollfd *fds);
+void collectExitedStages(PipelineUsage *usage, struct pollfd *fds, int numFds);
+void waitPipelineUsage(PipelineUsage *usage, Deadline *deadline);
+void reportPipelineUsage(PipelineUsage *usage);
+void freePipelineUsage(PipelineUsage *usage);
+
+#endif
\ No newline at end of file
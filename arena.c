@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+// the size of a regular block
+#define ARENA_BLOCK_SIZE (64 * 1024)
+// the alignment of every allocation
+#define ARENA_ALIGNMENT (sizeof(void *))
+
+// create a block that can hold at least the given size
+ArenaBlock *createArenaBlock(size_t size) {
+    if (size < ARENA_BLOCK_SIZE) {
+        size = ARENA_BLOCK_SIZE;
+    }
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + size);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+// create a new arena
+Arena *createArena() {
+    Arena *arena = malloc(sizeof(Arena));
+    arena->head = createArenaBlock(ARENA_BLOCK_SIZE);
+    arena->current = arena->head;
+    return arena;
+}
+
+// allocate memory that lives until the arena is reset
+void *arenaAlloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    ArenaBlock *block = arena->current;
+    while (block->used + size > block->size) {
+        // reuse the blocks kept from before the last reset
+        if (block->next != NULL && block->next->size >= size) {
+            block = block->next;
+            block->used = 0;
+            continue;
+        }
+        ArenaBlock *fresh = createArenaBlock(size);
+        fresh->next = block->next;
+        block->next = fresh;
+        block = fresh;
+    }
+    arena->current = block;
+    void *memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+// copy a string into the arena
+char *arenaStrdup(Arena *arena, const char *string) {
+    size_t len = strlen(string) + 1;
+    char *copy = arenaAlloc(arena, len);
+    memcpy(copy, string, len);
+    return copy;
+}
+
+// release everything allocated in the arena, the blocks are kept for reuse
+void resetArena(Arena *arena) {
+    arena->head->used = 0;
+    arena->current = arena->head;
+}
+
+// free the arena
+void freeArena(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
\ No newline at end of file
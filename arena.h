@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// structure for a block of arena memory
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+// structure for the arena
+typedef struct Arena {
+    ArenaBlock *head;
+    ArenaBlock *current;
+} Arena;
+
+Arena *createArena();
+void *arenaAlloc(Arena *arena, size_t size);
+char *arenaStrdup(Arena *arena, const char *string);
+void resetArena(Arena *arena);
+void freeArena(Arena *arena);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+// Runs a script of echo, true, false, test and printf lines through the shell twice: once
+// with the bare names, which the shell runs itself, and once with the paths of the programs,
+// which makes the shell start every one of them like before. Both scripts write the same
+// output, which is compared.
+//
+// usage: bench/builtins [shell] [lines]
+
+// structure for a line of the script, the names of the utilities in it are filled in
+typedef struct ScriptLine {
+    char *format;
+    int commands;
+} ScriptLine;
+
+// each line uses the utility names %1$s to %5$s: echo, true, false, test and printf
+ScriptLine scriptLines[] = {
+    { "%1$s line %6$d\n", 1 },
+    { "%2$s\n", 1 },
+    { "%3$s || %2$s\n", 2 },
+    { "%4$s -f %7$s/file && %1$s found\n", 2 },
+    { "%5$s \"%%s %%d\\n\" item %6$d\n", 1 },
+    { "%4$s %6$d -lt 50000 && %1$s -n small\n", 2 },
+    { "%1$s %6$d > %7$s/out\n", 1 },
+};
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// find a program in PATH
+int findProgram(char *name, char *path, size_t size) {
+    char *directories = getenv("PATH");
+    if (directories == NULL) {
+        return 0;
+    }
+    char *copy = strdup(directories);
+    int found = 0;
+    for (char *directory = strtok(copy, ":"); directory != NULL && !found; directory = strtok(NULL, ":")) {
+        snprintf(path, size, "%s/%s", directory, name);
+        found = access(path, X_OK) == 0;
+    }
+    free(copy);
+    return found;
+}
+
+// write the script with the given names of the utilities, returns the number of commands
+long writeScript(char *script, char **names, char *directory, int lines) {
+    FILE *file = fopen(script, "w");
+    long commands = 0;
+    int numScriptLines = sizeof(scriptLines) / sizeof(ScriptLine);
+    for (int i = 0; i < lines; i++) {
+        ScriptLine *line = &scriptLines[i % numScriptLines];
+        fprintf(file, line->format, names[0], names[1], names[2], names[3], names[4], i, directory);
+        commands += line->commands;
+    }
+    fclose(file);
+    return commands;
+}
+
+// run the shell with the script as its input and the output into a file, returns the wall time
+long long runScript(char *shell, char *script, char *output) {
+    long long start = nowNanoseconds();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int input = open(script, O_RDONLY);
+        int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        dup2(input, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        close(input);
+        close(out);
+        execl(shell, shell, NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "cannot run %s\n", shell);
+        exit(EXIT_FAILURE);
+    }
+    return nowNanoseconds() - start;
+}
+
+// check if two files have the same contents
+int sameContents(char *first, char *second) {
+    char command[8192];
+    snprintf(command, sizeof(command), "cmp -s %s %s", first, second);
+    return system(command) == 0;
+}
+
+int main(int argc, char **argv) {
+    char *shell = argc > 1 ? argv[1] : "./shell";
+    int lines = argc > 2 ? atoi(argv[2]) : 100000;
+    if (lines < 1) {
+        lines = 1;
+    }
+
+    char *utilities[] = { "echo", "true", "false", "test", "printf" };
+    char programs[5][4096];
+    char *programNames[5];
+    for (int i = 0; i < 5; i++) {
+        if (!findProgram(utilities[i], programs[i], sizeof(programs[i]))) {
+            fprintf(stderr, "cannot find %s\n", utilities[i]);
+            return EXIT_FAILURE;
+        }
+        programNames[i] = programs[i];
+    }
+
+    char directory[] = "/tmp/builtins-bench-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/file", directory);
+    close(open(path, O_WRONLY | O_CREAT, 0666));
+
+    char script[4096], output[4096], programScript[4096], programOutput[4096];
+    snprintf(script, sizeof(script), "%s/builtins.sh", directory);
+    snprintf(output, sizeof(output), "%s/builtins.out", directory);
+    snprintf(programScript, sizeof(programScript), "%s/programs.sh", directory);
+    snprintf(programOutput, sizeof(programOutput), "%s/programs.out", directory);
+    long commands = writeScript(script, utilities, directory, lines);
+    writeScript(programScript, programNames, directory, lines);
+
+    long long builtInTime = runScript(shell, script, output);
+    long long programTime = runScript(shell, programScript, programOutput);
+
+    fprintf(stdout, "%d lines, %ld commands\n", lines, commands);
+    fprintf(stdout, "%-10s %10s %14s %12s\n", "run as", "seconds", "commands/s", "us/command");
+    fprintf(stdout, "%-10s %10.2f %14.0f %12.2f\n", "programs", programTime / 1e9,
+            commands / (programTime / 1e9), programTime / 1e3 / commands);
+    fprintf(stdout, "%-10s %10.2f %14.0f %12.2f\n", "built-ins", builtInTime / 1e9,
+            commands / (builtInTime / 1e9), builtInTime / 1e3 / commands);
+    fprintf(stdout, "speedup %.1fx, output %s\n", (double) programTime / builtInTime,
+            sameContents(output, programOutput) ? "identical" : "DIFFERENT");
+
+    char command[sizeof(directory) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    system(command);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
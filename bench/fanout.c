@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "../launch.h"
+#include "../pump.h"
+
+// Measures writing the output of a command into N files. The old path lets the
+// command write the first file and then copies it into the others through a
+// 4 KB buffer, the new path copies the output into all files while it streams.
+//
+// usage: bench/fanout [size MB] [targets] [directory]
+
+// get the monotonic time in seconds
+double nowSeconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// run cat on the source with its output going to the given fd
+pid_t runCat(char *source, int output) {
+    char *argv[] = { "cat", source, NULL };
+    SpawnPlan plan;
+    initSpawnPlan(&plan);
+    addSpawnDup2(&plan, output, STDOUT_FILENO);
+    pid_t pid = spawnProcess(&plan, "/bin/cat", argv);
+    if (pid < 0) {
+        perror("spawnProcess");
+        exit(EXIT_FAILURE);
+    }
+    return pid;
+}
+
+// open the target files
+int *openTargets(char *directory, int numTargets) {
+    int *files = malloc(numTargets * sizeof(int));
+    for (int i = 0; i < numTargets; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/fanout-target-%d", directory, i);
+        files[i] = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    }
+    return files;
+}
+
+// remove the target files
+void removeTargets(char *directory, int numTargets) {
+    for (int i = 0; i < numTargets; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/fanout-target-%d", directory, i);
+        unlink(path);
+    }
+}
+
+// the command writes the first file, then it is copied into the others
+void benchmarkCopyAfter(char *source, char *directory, int numTargets) {
+    double start = nowSeconds();
+    int *files = openTargets(directory, numTargets);
+    long long bytesMoved = 0;
+
+    waitpid(runCat(source, files[0]), NULL, 0);
+    char buffer[4096];
+    for (int i = 1; i < numTargets; i++) {
+        ssize_t len;
+        lseek(files[0], 0, SEEK_SET);
+        while ((len = read(files[0], buffer, 4096)) > 0) {
+            write(files[i], buffer, len);
+            bytesMoved += 2 * len;
+        }
+    }
+    for (int i = 0; i < numTargets; i++) {
+        close(files[i]);
+    }
+    double elapsed = nowSeconds() - start;
+
+    free(files);
+    removeTargets(directory, numTargets);
+    fprintf(stdout, "%-12s %8.3f s   %10lld MB moved by the shell\n", "copy after", elapsed, bytesMoved >> 20);
+}
+
+// the output is copied into every file while the command runs
+void benchmarkFanout(char *source, char *directory, int numTargets) {
+    double start = nowSeconds();
+    Pump pump;
+    initPump(&pump);
+    int output = addOutputFanout(&pump.output, openTargets(directory, numTargets), numTargets);
+    pid_t pid = runCat(source, output);
+    close(output);
+    runPump(&pump, NULL);
+    long long bytesMoved = pump.output.bytesWritten;
+    waitpid(pid, NULL, 0);
+    double elapsed = nowSeconds() - start;
+
+    removeTargets(directory, numTargets);
+    fprintf(stdout, "%-12s %8.3f s   %10lld MB moved by the shell\n", "live fan-out", elapsed, bytesMoved >> 20);
+}
+
+int main(int argc, char **argv) {
+    long sizeMegabytes = argc > 1 ? atol(argv[1]) : 256;
+    int numTargets = argc > 2 ? atoi(argv[2]) : 4;
+    char *directory = argc > 3 ? argv[3] : "/tmp";
+    if (numTargets < 2) {
+        numTargets = 2;
+    }
+
+    // create the data written by the command
+    char source[4096];
+    snprintf(source, sizeof(source), "%s/fanout-source", directory);
+    int file = open(source, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    char *block = malloc(1 << 20);
+    memset(block, 'x', 1 << 20);
+    for (long i = 0; i < sizeMegabytes; i++) {
+        write(file, block, 1 << 20);
+    }
+    free(block);
+    close(file);
+
+    fprintf(stdout, "%ld MB into %d targets in %s\n", sizeMegabytes, numTargets, directory);
+    benchmarkCopyAfter(source, directory, numTargets);
+    benchmarkFanout(source, directory, numTargets);
+
+    unlink(source);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
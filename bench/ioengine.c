@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "../launch.h"
+#include "../pump.h"
+
+// Measures the engines that move redirection data on a multi-file redirection,
+// `cat < a < b < c < d > w > x > y > z`, where the shell feeds the inputs into
+// cat and copies its output into every target. Each engine runs on local disk
+// and on tmpfs.
+//
+// usage: bench/ioengine [size MB per file] [files] [disk directory] [tmpfs directory]
+
+// get the monotonic time in seconds
+double nowSeconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// get the path of a file of the benchmark
+void benchmarkPath(char *path, size_t size, char *directory, char *kind, int index) {
+    snprintf(path, size, "%s/ioengine-%s-%d", directory, kind, index);
+}
+
+// create the input files
+void createSources(char *directory, int numFiles, long sizeMegabytes) {
+    char *block = malloc(1 << 20);
+    memset(block, 'x', 1 << 20);
+    for (int i = 0; i < numFiles; i++) {
+        char path[4096];
+        benchmarkPath(path, sizeof(path), directory, "source", i);
+        int file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        for (long j = 0; j < sizeMegabytes; j++) {
+            write(file, block, 1 << 20);
+        }
+        close(file);
+    }
+    free(block);
+}
+
+// open the files of one kind
+int *openFiles(char *directory, char *kind, int numFiles, int flags) {
+    int *files = malloc(numFiles * sizeof(int));
+    for (int i = 0; i < numFiles; i++) {
+        char path[4096];
+        benchmarkPath(path, sizeof(path), directory, kind, i);
+        files[i] = open(path, flags | O_CLOEXEC, 0666);
+    }
+    return files;
+}
+
+// remove the files of one kind
+void removeFiles(char *directory, char *kind, int numFiles) {
+    for (int i = 0; i < numFiles; i++) {
+        char path[4096];
+        benchmarkPath(path, sizeof(path), directory, kind, i);
+        unlink(path);
+    }
+}
+
+// run the redirection once with the engine
+void benchmarkEngine(char *name, PumpEngine engine, char *directory, int numFiles, long sizeMegabytes) {
+    setPumpEngine(engine);
+    double start = nowSeconds();
+    Pump pump;
+    initPump(&pump);
+    int input = addInputFeed(&pump, openFiles(directory, "source", numFiles, O_RDONLY), numFiles);
+    int output = addOutputFanout(&pump.output, openFiles(directory, "target", numFiles, O_WRONLY | O_CREAT | O_TRUNC), numFiles);
+    if (getPumpEngine() != engine) {
+        fprintf(stdout, "%-8s %-16s not available, fell back to splice\n", name, directory);
+    }
+
+    char *argv[] = { "cat", NULL };
+    SpawnPlan plan;
+    initSpawnPlan(&plan);
+    addSpawnDup2(&plan, input, STDIN_FILENO);
+    addSpawnDup2(&plan, output, STDOUT_FILENO);
+    pid_t pid = spawnProcess(&plan, "/bin/cat", argv);
+    if (pid < 0) {
+        perror("spawnProcess");
+        exit(EXIT_FAILURE);
+    }
+    close(input);
+    close(output);
+    runPump(&pump, NULL);
+    waitpid(pid, NULL, 0);
+    double elapsed = nowSeconds() - start;
+
+    // every target gets every input file and a newline after each
+    double gigabytes = (double) numFiles * numFiles * sizeMegabytes / 1024.0;
+    fprintf(stdout, "%-8s %-16s %8.3f s  %8.2f GB/s written\n", name, directory, elapsed, gigabytes / elapsed);
+    removeFiles(directory, "target", numFiles);
+}
+
+int main(int argc, char **argv) {
+    long sizeMegabytes = argc > 1 ? atol(argv[1]) : 64;
+    int numFiles = argc > 2 ? atoi(argv[2]) : 4;
+    char *directories[] = { argc > 3 ? argv[3] : ".", argc > 4 ? argv[4] : "/dev/shm" };
+    if (numFiles < 2) {
+        numFiles = 2;
+    }
+
+    fprintf(stdout, "%d inputs of %ld MB into %d targets\n", numFiles, sizeMegabytes, numFiles);
+    for (int i = 0; i < 2; i++) {
+        createSources(directories[i], numFiles, sizeMegabytes);
+        benchmarkEngine("splice", PE_SPLICE, directories[i], numFiles, sizeMegabytes);
+        benchmarkEngine("io_uring", PE_URING, directories[i], numFiles, sizeMegabytes);
+        removeFiles(directories[i], "source", numFiles);
+    }
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "../launch.h"
+
+// Measures how long the shell is blocked launching one pipeline stage, for the
+// fork path and the posix_spawn path. The shell heap is simulated by touching a
+// large allocation, since fork has to copy its page tables.
+//
+// usage: bench/launch [heap MB] [iterations]
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// compare two latencies
+int compareLatency(const void *a, const void *b) {
+    long long first = *(const long long *) a;
+    long long second = *(const long long *) b;
+    return (first > second) - (first < second);
+}
+
+// launch /bin/true the way runCommand launches a stage and report the latencies
+void benchmarkEngine(char *name, SpawnEngine engine, int iterations, int devNull) {
+    char *argv[] = { "true", NULL };
+    long long *launch = malloc(iterations * sizeof(long long));
+    long long *total = malloc(iterations * sizeof(long long));
+
+    setSpawnEngine(engine);
+    for (int i = 0; i < iterations; i++) {
+        SpawnPlan plan;
+        initSpawnPlan(&plan);
+        addSpawnDefaultSignal(&plan, SIGCHLD);
+        addSpawnDefaultSignal(&plan, SIGINT);
+        addSpawnDup2(&plan, devNull, STDOUT_FILENO);
+        addSpawnClose(&plan, devNull);
+
+        long long start = nowNanoseconds();
+        pid_t pid = spawnProcess(&plan, "/bin/true", argv);
+        long long launched = nowNanoseconds();
+        if (pid < 0) {
+            perror("spawnProcess");
+            exit(EXIT_FAILURE);
+        }
+        waitpid(pid, NULL, 0);
+        long long finished = nowNanoseconds();
+
+        launch[i] = launched - start;
+        total[i] = finished - start;
+    }
+
+    qsort(launch, iterations, sizeof(long long), compareLatency);
+    qsort(total, iterations, sizeof(long long), compareLatency);
+    fprintf(stdout, "%-12s launch p50 %8.1f us  p99 %8.1f us   launch+exit p50 %8.1f us  p99 %8.1f us\n",
+            name,
+            launch[iterations / 2] / 1000.0, launch[iterations * 99 / 100] / 1000.0,
+            total[iterations / 2] / 1000.0, total[iterations * 99 / 100] / 1000.0);
+
+    free(launch);
+    free(total);
+}
+
+int main(int argc, char **argv) {
+    long heapMegabytes = argc > 1 ? atol(argv[1]) : 256;
+    int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    // make the heap resident so fork has page tables to copy
+    size_t heapSize = heapMegabytes * 1024 * 1024;
+    char *heap = malloc(heapSize > 0 ? heapSize : 1);
+    memset(heap, 1, heapSize);
+
+    int devNull = open("/dev/null", O_WRONLY);
+
+    fprintf(stdout, "stage launch latency with a %ld MB heap, %d iterations\n", heapMegabytes, iterations);
+    benchmarkEngine("fork", SE_FORK, iterations, devNull);
+    benchmarkEngine("posix_spawn", SE_POSIX_SPAWN, iterations, devNull);
+
+    close(devNull);
+    free(heap);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+// Runs a large script through the shell with both lexer input paths: SHELL_INPUT=byte reads
+// the script one byte per read() like the shell did before, and the default reads it in blocks.
+// The lines only use commands the shell runs itself, so reading and parsing the script is most
+// of the work. The read() calls come from the input spans of a separate SHELL_PROFILE=summary
+// pass, so the timed runs are not profiled.
+//
+// usage: bench/lexinput [shell] [lines] [runs]
+
+// structure for an input path of the lexer
+typedef struct InputPath {
+    char *name;
+    char *mode;
+} InputPath;
+
+InputPath inputPaths[] = {
+    { "byte", "byte" },
+    { "block", NULL },
+};
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// write the script
+void writeScript(char *script, int lines) {
+    FILE *file = fopen(script, "w");
+    for (int i = 0; i < lines; i++) {
+        switch (i % 3) {
+            case 0:
+                fprintf(file, "test %d -gt 0 && true\n", i);
+                break;
+            case 1:
+                fprintf(file, "false || true ; true\n");
+                break;
+            default:
+                fprintf(file, "test -n \"line %d of the script\"\n", i);
+                break;
+        }
+    }
+    fclose(file);
+}
+
+// run the shell with the script as its input, the output is discarded and stderr goes to the
+// given file; returns the wall time
+long long runScript(char *shell, char *script, InputPath *path, char *profile, char *errors) {
+    long long start = nowNanoseconds();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int input = open(script, O_RDONLY);
+        int devNull = open("/dev/null", O_WRONLY);
+        int error = errors != NULL ? open(errors, O_WRONLY | O_CREAT | O_TRUNC, 0666) : devNull;
+        dup2(input, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(error, STDERR_FILENO);
+        if (path->mode != NULL) {
+            setenv("SHELL_INPUT", path->mode, 1);
+        } else {
+            unsetenv("SHELL_INPUT");
+        }
+        if (profile != NULL) {
+            setenv("SHELL_PROFILE", profile, 1);
+        } else {
+            unsetenv("SHELL_PROFILE");
+        }
+        execl(shell, shell, NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "cannot run %s\n", shell);
+        exit(EXIT_FAILURE);
+    }
+    return nowNanoseconds() - start;
+}
+
+// count the read() calls of the lexer from the input row of a profile summary, -1 if it has none
+long long countReads(char *summary) {
+    FILE *file = fopen(summary, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    long long reads = -1;
+    char line[4096];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        sscanf(line, "input %lld", &reads);
+    }
+    fclose(file);
+    return reads;
+}
+
+int main(int argc, char **argv) {
+    char *shell = argc > 1 ? argv[1] : "./shell";
+    int lines = argc > 2 ? atoi(argv[2]) : 200000;
+    int runs = argc > 3 ? atoi(argv[3]) : 3;
+    if (lines < 1) {
+        lines = 1;
+    }
+    if (runs < 1) {
+        runs = 1;
+    }
+
+    char directory[] = "/tmp/lexinput-bench-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    char script[4096], summary[4096];
+    snprintf(script, sizeof(script), "%s/script.sh", directory);
+    snprintf(summary, sizeof(summary), "%s/summary", directory);
+    writeScript(script, lines);
+    struct stat info;
+    stat(script, &info);
+
+    fprintf(stdout, "%d lines, %lld bytes, best of %d runs\n", lines, (long long) info.st_size, runs);
+    fprintf(stdout, "%-8s %12s %14s %10s %10s\n", "input", "read calls", "bytes/read", "seconds", "MB/s");
+    double byteTime = 0;
+    for (int i = 0; i < (int) (sizeof(inputPaths) / sizeof(InputPath)); i++) {
+        InputPath *path = &inputPaths[i];
+        long long best = -1;
+        for (int run = 0; run < runs; run++) {
+            long long time = runScript(shell, script, path, NULL, NULL);
+            if (best < 0 || time < best) {
+                best = time;
+            }
+        }
+        runScript(shell, script, path, "summary", summary);
+        long long reads = countReads(summary);
+        fprintf(stdout, "%-8s %12lld %14.1f %10.2f %10.2f\n", path->name, reads,
+                reads > 0 ? (double) info.st_size / reads : 0, best / 1e9, info.st_size / 1e6 / (best / 1e9));
+        if (i == 0) {
+            byteTime = best;
+        } else {
+            fprintf(stdout, "speedup %.2fx over byte reads\n", byteTime / best);
+        }
+    }
+
+    char command[sizeof(directory) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    system(command);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
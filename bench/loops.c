@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+
+// Runs the same work through the shell twice: once as a for loop over {1..N} whose body is
+// parsed once, and once unrolled into a script that repeats the body with every value written
+// out, which the shell has to read and parse line by line. The sizes of both scripts and their
+// run times are printed, and their outputs are compared.
+//
+// usage: bench/loops [shell] [iterations]
+
+// the body of the loop, %1$s is where the variable or its value goes
+char *bodyLines[] = {
+    "echo item %1$s\n",
+    "test %1$s -gt 0 && printf \"%%s done\\n\" %1$s\n",
+    "false || echo -n %1$s\n",
+    "test -d %2$s && echo %1$s\n",
+};
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// write the body with the given word in place of the variable
+void writeBody(FILE *file, char *word, char *directory) {
+    for (int i = 0; i < sizeof(bodyLines) / sizeof(char *); i++) {
+        fprintf(file, bodyLines[i], word, directory);
+    }
+}
+
+// write the loop script
+void writeLoopScript(char *script, char *directory, int iterations) {
+    FILE *file = fopen(script, "w");
+    fprintf(file, "for i in {1..%d}; do\n", iterations);
+    writeBody(file, "$i", directory);
+    fprintf(file, "done\n");
+    fclose(file);
+}
+
+// write the unrolled script
+void writeUnrolledScript(char *script, char *directory, int iterations) {
+    FILE *file = fopen(script, "w");
+    char value[32];
+    for (int i = 1; i <= iterations; i++) {
+        snprintf(value, sizeof(value), "%d", i);
+        writeBody(file, value, directory);
+    }
+    fclose(file);
+}
+
+// get the size of a file
+long long fileSize(char *path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? info.st_size : -1;
+}
+
+// run the shell with the script as its input and the output into a file, returns the wall time
+long long runScript(char *shell, char *script, char *output) {
+    long long start = nowNanoseconds();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int input = open(script, O_RDONLY);
+        int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        dup2(input, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        close(input);
+        close(out);
+        execl(shell, shell, NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "cannot run %s\n", shell);
+        exit(EXIT_FAILURE);
+    }
+    return nowNanoseconds() - start;
+}
+
+// check if two files have the same contents
+int sameContents(char *first, char *second) {
+    char command[8192];
+    snprintf(command, sizeof(command), "cmp -s %s %s", first, second);
+    return system(command) == 0;
+}
+
+int main(int argc, char **argv) {
+    char *shell = argc > 1 ? argv[1] : "./shell";
+    int iterations = argc > 2 ? atoi(argv[2]) : 100000;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    char directory[] = "/tmp/loops-bench-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    char loopScript[4096], loopOutput[4096], unrolledScript[4096], unrolledOutput[4096];
+    snprintf(loopScript, sizeof(loopScript), "%s/loop.sh", directory);
+    snprintf(loopOutput, sizeof(loopOutput), "%s/loop.out", directory);
+    snprintf(unrolledScript, sizeof(unrolledScript), "%s/unrolled.sh", directory);
+    snprintf(unrolledOutput, sizeof(unrolledOutput), "%s/unrolled.out", directory);
+    writeLoopScript(loopScript, directory, iterations);
+    writeUnrolledScript(unrolledScript, directory, iterations);
+
+    long long loopTime = runScript(shell, loopScript, loopOutput);
+    long long unrolledTime = runScript(shell, unrolledScript, unrolledOutput);
+
+    int numBodyLines = sizeof(bodyLines) / sizeof(char *);
+    fprintf(stdout, "%d iterations, %d lines in the body\n", iterations, numBodyLines);
+    fprintf(stdout, "%-10s %14s %10s %14s\n", "script", "bytes", "seconds", "us/iteration");
+    fprintf(stdout, "%-10s %14lld %10.2f %14.2f\n", "unrolled", fileSize(unrolledScript),
+            unrolledTime / 1e9, unrolledTime / 1e3 / iterations);
+    fprintf(stdout, "%-10s %14lld %10.2f %14.2f\n", "for loop", fileSize(loopScript),
+            loopTime / 1e9, loopTime / 1e3 / iterations);
+    fprintf(stdout, "speedup %.1fx, output %s\n", (double) unrolledTime / loopTime,
+            sameContents(loopOutput, unrolledOutput) ? "identical" : "DIFFERENT");
+
+    char command[sizeof(directory) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    system(command);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+// Measures a long pipeline run by the shell: how many descriptors each stage
+// inherits and how long the pipeline takes. The stages are this program in
+// stage mode, which reports its open descriptors and copies stdin to stdout.
+//
+// usage: bench/pipefds [shell] [stages] [runs]
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// compare two durations
+int compareDuration(const void *a, const void *b) {
+    long long first = *(const long long *) a;
+    long long second = *(const long long *) b;
+    return (first > second) - (first < second);
+}
+
+// report the open descriptors of the stage and pass the input on
+int runStage(char *report) {
+    // the descriptor of the directory itself is not counted
+    int numFds = -1;
+    DIR *directory = opendir("/proc/self/fd");
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            numFds++;
+        }
+    }
+    closedir(directory);
+    int file = open(report, O_WRONLY | O_APPEND | O_CREAT, 0666);
+    char line[32];
+    int len = snprintf(line, sizeof(line), "%d\n", numFds);
+    write(file, line, len);
+    close(file);
+
+    char buffer[4096];
+    ssize_t copied;
+    while ((copied = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+        write(STDOUT_FILENO, buffer, copied);
+    }
+    return EXIT_SUCCESS;
+}
+
+// run the shell on the script once and return how long it took
+long long runShell(char *shell, char *script) {
+    long long start = nowNanoseconds();
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(shell, shell, script, (char *) NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "cannot run %s\n", shell);
+        exit(EXIT_FAILURE);
+    }
+    return nowNanoseconds() - start;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "--stage") == 0) {
+        return runStage(argv[2]);
+    }
+    char *shell = argc > 1 ? argv[1] : "./shell";
+    int stages = argc > 2 ? atoi(argv[2]) : 100;
+    int runs = argc > 3 ? atoi(argv[3]) : 20;
+    if (stages < 2) {
+        stages = 2;
+    }
+    if (runs < 1) {
+        runs = 1;
+    }
+
+    char directory[] = "/tmp/pipefds-bench-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    char self[4096];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len < 0) {
+        perror("readlink");
+        return EXIT_FAILURE;
+    }
+    self[len] = '\0';
+    char script[sizeof(directory) + 16];
+    char report[sizeof(directory) + 16];
+    snprintf(script, sizeof(script), "%s/script", directory);
+    snprintf(report, sizeof(report), "%s/report", directory);
+    FILE *file = fopen(script, "w");
+    for (int i = 0; i < stages; i++) {
+        fprintf(file, "%s%s --stage %s", i > 0 ? " | " : "", self, report);
+    }
+    fprintf(file, " < /dev/null > /dev/null\n");
+    fclose(file);
+
+    long long *durations = malloc(runs * sizeof(long long));
+    for (int i = 0; i < runs; i++) {
+        durations[i] = runShell(shell, script);
+    }
+    qsort(durations, runs, sizeof(long long), compareDuration);
+
+    // every stage wrote how many descriptors it had open, 3 is the minimum
+    long long total = 0;
+    int peak = 0, count = 0, numFds;
+    file = fopen(report, "r");
+    while (file != NULL && fscanf(file, "%d", &numFds) == 1) {
+        total += numFds;
+        peak = numFds > peak ? numFds : peak;
+        count++;
+    }
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    fprintf(stdout, "pipeline of %d stages, %d runs\n", stages, runs);
+    fprintf(stdout, "descriptors per stage  avg %8.2f  peak %6d\n", count > 0 ? (double) total / count : 0.0, peak);
+    fprintf(stdout, "pipeline time          p50 %8.2f ms  p99 %8.2f ms\n",
+            durations[runs / 2] / 1000000.0, durations[runs * 99 / 100] / 1000000.0);
+    free(durations);
+
+    char command[sizeof(directory) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    system(command);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
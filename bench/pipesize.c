@@ -0,0 +1,94 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "../launch.h"
+#include "../pipesize.h"
+
+// Measures `head -c N /dev/zero | cat | cat | cat > /dev/null` with the pipes
+// between the stages sized the way runPipeline sizes them, for several sizes.
+//
+// usage: bench/pipesize [gigabytes]
+
+#define NUM_STAGES 4
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// run the pipeline once with the given pipe size
+void benchmarkPipeSize(char *size, char *bytes, int devNull) {
+    if (!setPipeSize(size)) {
+        fprintf(stdout, "%-8s not allowed on this system\n", size);
+        return;
+    }
+    char *argvs[NUM_STAGES][4] = {
+        { "head", "-c", bytes, NULL },
+        { "cat", NULL },
+        { "cat", NULL },
+        { "cat", NULL }
+    };
+    char *paths[NUM_STAGES] = { "/usr/bin/head", "/bin/cat", "/bin/cat", "/bin/cat" };
+    int pipes[NUM_STAGES - 1][2];
+    pid_t pids[NUM_STAGES];
+
+    long long start = nowNanoseconds();
+    for (int i = 0; i < NUM_STAGES - 1; i++) {
+        pipe2(pipes[i], O_CLOEXEC);
+        sizePipe(pipes[i][1]);
+    }
+    int zero = open("/dev/zero", O_RDONLY | O_CLOEXEC);
+    for (int i = 0; i < NUM_STAGES; i++) {
+        SpawnPlan plan;
+        initSpawnPlan(&plan);
+        addSpawnDup2(&plan, i == 0 ? zero : pipes[i - 1][0], STDIN_FILENO);
+        addSpawnDup2(&plan, i == NUM_STAGES - 1 ? devNull : pipes[i][1], STDOUT_FILENO);
+        pids[i] = spawnProcess(&plan, paths[i], argvs[i]);
+        if (pids[i] < 0) {
+            perror(paths[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(zero);
+    for (int i = 0; i < NUM_STAGES - 1; i++) {
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+    }
+
+    long switches = 0;
+    double cpu = 0;
+    for (int i = 0; i < NUM_STAGES; i++) {
+        struct rusage usage;
+        wait4(pids[i], NULL, 0, &usage);
+        switches += usage.ru_nvcsw + usage.ru_nivcsw;
+        cpu += usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    }
+    double elapsed = (nowNanoseconds() - start) / 1e9;
+    double gigabytes = atof(bytes) / (1024.0 * 1024 * 1024);
+    fprintf(stdout, "%-8s %8.3f s  %8.2f GB/s  cpu %8.3f s  %10ld context switches\n",
+            size, elapsed, gigabytes / elapsed, cpu, switches);
+}
+
+int main(int argc, char **argv) {
+    double gigabytes = argc > 1 ? atof(argv[1]) : 2;
+    char bytes[32];
+    snprintf(bytes, sizeof(bytes), "%lld", (long long) (gigabytes * 1024 * 1024 * 1024));
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    fprintf(stdout, "%.1f GB through head | cat | cat | cat\n", gigabytes);
+    char *sizes[] = { "default", "256K", "1M", "4M", "max" };
+    for (int i = 0; i < 5; i++) {
+        benchmarkPipeSize(sizes[i], bytes, devNull);
+    }
+
+    close(devNull);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
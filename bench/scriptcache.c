@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+// Measures how long the shell takes to run a script when it is parsed from
+// scratch and when it is loaded from the script cache. The script only uses
+// built-ins, so the time is spent reading it rather than running commands.
+//
+// usage: bench/scriptcache [shell] [lines] [runs]
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// compare two durations
+int compareDuration(const void *a, const void *b) {
+    long long first = *(const long long *) a;
+    long long second = *(const long long *) b;
+    return (first > second) - (first < second);
+}
+
+// run the shell on the script once and return how long it took
+long long runShell(char *shell, char *script, char *cacheDirectory) {
+    long long start = nowNanoseconds();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        close(devNull);
+        if (cacheDirectory != NULL) {
+            setenv("SHELL_SCRIPT_CACHE", cacheDirectory, 1);
+        } else {
+            unsetenv("SHELL_SCRIPT_CACHE");
+        }
+        execl(shell, shell, script, (char *) NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "cannot run %s\n", shell);
+        exit(EXIT_FAILURE);
+    }
+    return nowNanoseconds() - start;
+}
+
+// run the shell a number of times and report the durations
+void benchmarkRuns(char *name, char *shell, char *script, char *cacheDirectory, int runs) {
+    long long *durations = malloc(runs * sizeof(long long));
+    for (int i = 0; i < runs; i++) {
+        durations[i] = runShell(shell, script, cacheDirectory);
+    }
+    qsort(durations, runs, sizeof(long long), compareDuration);
+    fprintf(stdout, "%-12s p50 %8.2f ms  p99 %8.2f ms\n",
+            name, durations[runs / 2] / 1000000.0, durations[runs * 99 / 100] / 1000000.0);
+    free(durations);
+}
+
+int main(int argc, char **argv) {
+    char *shell = argc > 1 ? argv[1] : "./shell";
+    int lines = argc > 2 ? atoi(argv[2]) : 20000;
+    int runs = argc > 3 ? atoi(argv[3]) : 50;
+    if (runs < 1) {
+        runs = 1;
+    }
+
+    char directory[] = "/tmp/scriptcache-bench-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    char script[sizeof(directory) + 16];
+    snprintf(script, sizeof(script), "%s/script", directory);
+    FILE *file = fopen(script, "w");
+    for (int i = 0; i < lines; i++) {
+        fprintf(file, "cd . && cd . ; cd \"%s\" || cd / ; status\n", directory);
+    }
+    fclose(file);
+
+    fprintf(stdout, "script of %d lines, %d runs\n", lines, runs);
+    benchmarkRuns("parse", shell, script, NULL, runs);
+    // the first run compiles the script and writes the cache
+    runShell(shell, script, directory);
+    benchmarkRuns("cached", shell, script, directory, runs);
+
+    char command[sizeof(directory) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    system(command);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
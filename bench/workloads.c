@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+// Runs the shell through representative scripts and reports for each of them
+// the commands per second, the p50 and p99 latency of a command line, the
+// system calls of one run when strace is installed and the peak RSS. The timed
+// runs are not profiled. The latencies come from the chain spans of a separate
+// SHELL_PROFILE run, so they are measured inside the shell rather than around
+// it. Multiple redirections and the directory stack are only used when the shell is built with EXT_PROMPT.
+//
+// usage: bench/workloads [shell] [runs]
+
+// structure for a workload, a script of lines that each run a number of commands
+typedef struct Workload {
+    char *name;
+    int lines;
+    int commandsPerLine;
+    void (*writeLine)(FILE *file, char *directory, int line);
+} Workload;
+
+// structure for the measurements of a workload over all runs
+typedef struct WorkloadResult {
+    long long totalTime;
+    double *latencies;
+    int numLatencies;
+    int latenciesCapacity;
+    long maxRss;
+    long syscalls;
+} WorkloadResult;
+
+// whether the shell has the extended syntax
+int extended = 0;
+
+// get the monotonic time in nanoseconds
+long long nowNanoseconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// compare two latencies
+int compareLatency(const void *a, const void *b) {
+    double first = *(const double *) a;
+    double second = *(const double *) b;
+    return (first > second) - (first < second);
+}
+
+// many tiny commands, each one a process of its own, the path keeps the shell from running true itself
+void writeTinyLine(FILE *file, char *directory, int line) {
+    fprintf(file, "/bin/true\n");
+}
+
+// long pipelines
+void writePipelineLine(FILE *file, char *directory, int line) {
+    fprintf(file, "echo %d | cat | cat | cat | cat | cat | cat | wc -c\n", line);
+}
+
+// several input, output and error files per command
+void writeRedirectLine(FILE *file, char *directory, int line) {
+    if (!extended) {
+        fprintf(file, "cat < %s/input > %s/output1\n", directory, directory);
+        return;
+    }
+    fprintf(file, "cat < %s/input < %s/input > %s/output1 > %s/output2 n> %s/error\n",
+            directory, directory, directory, directory, directory);
+}
+
+// thousands of background jobs
+void writeBackgroundLine(FILE *file, char *directory, int line) {
+    fprintf(file, "true &\n");
+}
+
+// changing between directories with the built-ins
+void writeDirectoryLine(FILE *file, char *directory, int line) {
+    if (!extended) {
+        fprintf(file, "cd %s/a && cd .. ; cd %s/a ; cd ..\n", directory, directory);
+        return;
+    }
+    fprintf(file, "cd %s/a && cd .. ; pushd %s/a ; popd\n", directory, directory);
+}
+
+Workload workloads[] = {
+    { "tiny", 5000, 1, writeTinyLine },
+    { "pipeline", 500, 8, writePipelineLine },
+    { "redirect", 2000, 1, writeRedirectLine },
+    { "background", 2000, 1, writeBackgroundLine },
+    { "directory", 5000, 4, writeDirectoryLine },
+};
+
+// add the durations of the chain spans in a trace to the latencies
+void readChainLatencies(char *trace, WorkloadResult *result) {
+    FILE *file = fopen(trace, "r");
+    if (file == NULL) {
+        return;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strstr(line, "\"name\":\"chain\"") == NULL) {
+            continue;
+        }
+        char *duration = strstr(line, "\"dur\":");
+        if (duration == NULL) {
+            continue;
+        }
+        if (result->numLatencies == result->latenciesCapacity) {
+            result->latenciesCapacity = result->latenciesCapacity == 0 ? 4096 : result->latenciesCapacity * 2;
+            result->latencies = realloc(result->latencies, result->latenciesCapacity * sizeof(double));
+        }
+        result->latencies[result->numLatencies++] = strtod(duration + strlen("\"dur\":"), NULL);
+    }
+    fclose(file);
+}
+
+// run a program with the script as its input and its output discarded, returns the wall time
+long long runScript(char **argv, char *script, char *trace, struct rusage *usage) {
+    long long start = nowNanoseconds();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int input = open(script, O_RDONLY);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(input, STDIN_FILENO);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        close(input);
+        close(devNull);
+        if (trace != NULL) {
+            setenv("SHELL_PROFILE", trace, 1);
+        } else {
+            unsetenv("SHELL_PROFILE");
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    int status;
+    wait4(pid, &status, 0, usage);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+        fprintf(stderr, "cannot run %s\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    return nowNanoseconds() - start;
+}
+
+// count the system calls of the shell and its commands with strace, -1 if strace is missing
+long countSyscalls(char *shell, char *script, char *directory) {
+    if (system("command -v strace > /dev/null 2>&1") != 0) {
+        return -1;
+    }
+    char output[4096];
+    snprintf(output, sizeof(output), "%s/strace", directory);
+    char *argv[] = { "strace", "-f", "-c", "-o", output, shell, NULL };
+    struct rusage usage;
+    runScript(argv, script, NULL, &usage);
+
+    // the last row of the summary holds the totals: % time, seconds, usecs/call, calls
+    long calls = -1;
+    FILE *file = fopen(output, "r");
+    char line[4096];
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+        if (strstr(line, " total") != NULL) {
+            sscanf(line, "%*f %*f %*d %ld", &calls);
+        }
+    }
+    if (file != NULL) {
+        fclose(file);
+    }
+    return calls;
+}
+
+// write the script of a workload
+void writeScript(Workload *workload, char *script, char *directory) {
+    FILE *file = fopen(script, "w");
+    for (int i = 0; i < workload->lines; i++) {
+        workload->writeLine(file, directory, i);
+    }
+    fclose(file);
+}
+
+// create the files and directories the workloads use
+void createFixtures(char *directory) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/a", directory);
+    mkdir(path, 0777);
+    snprintf(path, sizeof(path), "%s/input", directory);
+    FILE *file = fopen(path, "w");
+    for (int i = 0; i < 1024; i++) {
+        fprintf(file, "%063d\n", i);
+    }
+    fclose(file);
+}
+
+// check if the shell accepts a command with two input files
+int probeExtendedShell(char *shell, char *directory) {
+    char script[4096];
+    char output[4096];
+    snprintf(script, sizeof(script), "%s/probe.sh", directory);
+    snprintf(output, sizeof(output), "%s/probe", directory);
+    FILE *file = fopen(script, "w");
+    fprintf(file, "cat < %s/input < %s/input > %s\n", directory, directory, output);
+    fclose(file);
+    char *argv[] = { shell, NULL };
+    struct rusage usage;
+    runScript(argv, script, NULL, &usage);
+    return access(output, F_OK) == 0;
+}
+
+// run a workload a number of times and report it
+void benchmarkWorkload(Workload *workload, char *shell, char *directory, int runs) {
+    char script[4096];
+    char trace[4096];
+    snprintf(script, sizeof(script), "%s/%s.sh", directory, workload->name);
+    snprintf(trace, sizeof(trace), "%s/%s.json", directory, workload->name);
+    writeScript(workload, script, directory);
+
+    WorkloadResult result;
+    memset(&result, 0, sizeof(result));
+    char *argv[] = { shell, NULL };
+    for (int i = 0; i < runs; i++) {
+        struct rusage usage;
+        result.totalTime += runScript(argv, script, NULL, &usage);
+        if (usage.ru_maxrss > result.maxRss) {
+            result.maxRss = usage.ru_maxrss;
+        }
+    }
+    // the profiler costs time of its own, so the latencies come from a run that is not timed
+    struct rusage usage;
+    runScript(argv, script, trace, &usage);
+    readChainLatencies(trace, &result);
+    result.syscalls = countSyscalls(shell, script, directory);
+
+    double commands = (double) workload->lines * workload->commandsPerLine * runs;
+    double p50 = 0, p99 = 0;
+    if (result.numLatencies > 0) {
+        qsort(result.latencies, result.numLatencies, sizeof(double), compareLatency);
+        p50 = result.latencies[result.numLatencies / 2];
+        p99 = result.latencies[(long long) result.numLatencies * 99 / 100];
+    }
+    char syscalls[32];
+    if (result.syscalls < 0) {
+        snprintf(syscalls, sizeof(syscalls), "-");
+    } else {
+        snprintf(syscalls, sizeof(syscalls), "%ld", result.syscalls);
+    }
+    fprintf(stdout, "%-12s %12.0f %10.1f %10.1f %12s %10ld\n", workload->name,
+            commands / (result.totalTime / 1e9), p50, p99, syscalls, result.maxRss);
+    free(result.latencies);
+}
+
+int main(int argc, char **argv) {
+    char *shell = argc > 1 ? argv[1] : "./shell";
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+    if (runs < 1) {
+        runs = 1;
+    }
+
+    char directory[] = "/tmp/workloads-bench-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    createFixtures(directory);
+    extended = probeExtendedShell(shell, directory);
+
+    fprintf(stdout, "%d timed runs per workload, latency per command line from a profiled run, syscalls of one run, %s syntax\n",
+            runs, extended ? "extended" : "basic");
+    fprintf(stdout, "%-12s %12s %10s %10s %12s %10s\n", "workload", "commands/s", "p50 us", "p99 us", "syscalls", "rss KB");
+    for (int i = 0; i < (int) (sizeof(workloads) / sizeof(Workload)); i++) {
+        benchmarkWorkload(&workloads[i], shell, directory, runs);
+    }
+
+    char command[sizeof(directory) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    system(command);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,228 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "deadline.h"
+
+// structure for the name of a signal
+typedef struct SignalName {
+    char *name;
+    int signal;
+} SignalName;
+
+SignalName signalNames[] = {
+    { "HUP", SIGHUP }, { "INT", SIGINT }, { "QUIT", SIGQUIT }, { "KILL", SIGKILL },
+    { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 }, { "PIPE", SIGPIPE }, { "ALRM", SIGALRM },
+    { "TERM", SIGTERM }, { "CONT", SIGCONT }, { "STOP", SIGSTOP }, { NULL, 0 }
+};
+
+// the process group that gets SIGINT while a pipeline with a limit runs in a group of its own
+pid_t interruptedGroup = -1;
+
+// read a duration like "10", "0.5", "2m" or "1h" in milliseconds, returns -1 if it is invalid
+long long parseDuration(char *value) {
+    char *endPtr = NULL;
+    double duration = strtod(value, &endPtr);
+    if (endPtr == value || duration < 0) {
+        return -1;
+    }
+    if (strcmp(endPtr, "m") == 0) {
+        duration *= 60;
+    } else if (strcmp(endPtr, "h") == 0) {
+        duration *= 3600;
+    } else if (strcmp(endPtr, "d") == 0) {
+        duration *= 86400;
+    } else if (*endPtr != '\0' && strcmp(endPtr, "s") != 0) {
+        return -1;
+    }
+    // nan, inf and limits too large for the timer are as invalid as any other bad duration
+    if (!isfinite(duration) || duration * 1000 >= (double) LLONG_MAX) {
+        return -1;
+    }
+    // a limit below a millisecond still expires
+    long long milliseconds = (long long) (duration * 1000);
+    return milliseconds == 0 && duration > 0 ? 1 : milliseconds;
+}
+
+// read a signal like "9", "KILL" or "SIGKILL", returns -1 if it is invalid
+int parseSignal(char *value) {
+    char *endPtr = NULL;
+    int signal = (int) strtol(value, &endPtr, 10);
+    if (endPtr != value && *endPtr == '\0') {
+        return signal > 0 && signal < NSIG ? signal : -1;
+    }
+    if (strncasecmp(value, "SIG", 3) == 0) {
+        value += 3;
+    }
+    for (int i = 0; signalNames[i].name != NULL; i++) {
+        if (strcasecmp(value, signalNames[i].name) == 0) {
+            return signalNames[i].signal;
+        }
+    }
+    return -1;
+}
+
+// create a deadline without a limit
+void initDeadline(Deadline *deadline) {
+    deadline->timer = -1;
+    deadline->signal = SIGTERM;
+    deadline->processGroup = -1;
+    deadline->ids = NULL;
+    deadline->numIds = 0;
+    deadline->expired = 0;
+}
+
+// start the timer of the limit, returns 0 if it could not be created
+int startDeadline(Deadline *deadline, long long milliseconds, int signal) {
+    deadline->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (deadline->timer < 0) {
+        return 0;
+    }
+    struct itimerspec limit;
+    memset(&limit, 0, sizeof(limit));
+    limit.it_value.tv_sec = milliseconds / 1000;
+    limit.it_value.tv_nsec = (milliseconds % 1000) * 1000000;
+    timerfd_settime(deadline->timer, 0, &limit, NULL);
+    deadline->signal = signal;
+    return 1;
+}
+
+// pass SIGINT on to the stages, which do not get it from the terminal in their own group
+void forwardInterrupt(int signo) {
+    if (interruptedGroup > 0) {
+        killpg(interruptedGroup, SIGINT);
+    }
+}
+
+// set the stages the deadline stops when the time is up
+void setDeadlineStages(Deadline *deadline, pid_t processGroup, pid_t *ids, int numIds) {
+    deadline->processGroup = processGroup;
+    deadline->ids = ids;
+    deadline->numIds = numIds;
+    if (deadline->timer >= 0 && processGroup > 0) {
+        interruptedGroup = processGroup;
+        struct sigaction sigint;
+        sigemptyset(&sigint.sa_mask);
+        sigint.sa_flags = SA_RESTART;
+        sigint.sa_handler = &forwardInterrupt;
+        sigaction(SIGINT, &sigint, NULL);
+    }
+}
+
+// signal the stages if the time is up
+void checkDeadline(Deadline *deadline) {
+    unsigned long long expirations;
+    if (deadline->timer < 0 || deadline->expired || read(deadline->timer, &expirations, sizeof(expirations)) <= 0) {
+        return;
+    }
+    deadline->expired = 1;
+    if (deadline->processGroup > 0) {
+        // the whole pipeline is stopped at once
+        killpg(deadline->processGroup, deadline->signal);
+    } else {
+        for (int i = 0; i < deadline->numIds; i++) {
+            if (deadline->ids[i] > 0) {
+                kill(deadline->ids[i], deadline->signal);
+            }
+        }
+    }
+    // like coreutils timeout, a stage stopped by SIGTTIN or SIGTSTP is continued so it gets the signal
+    if (deadline->signal != SIGKILL && deadline->signal != SIGCONT) {
+        if (deadline->processGroup > 0) {
+            killpg(deadline->processGroup, SIGCONT);
+            return;
+        }
+        for (int i = 0; i < deadline->numIds; i++) {
+            if (deadline->ids[i] > 0) {
+                kill(deadline->ids[i], SIGCONT);
+            }
+        }
+    }
+}
+
+// check if a stage exited, without collecting it
+int hasStageExited(pid_t pid) {
+    siginfo_t info;
+    info.si_pid = 0;
+    return waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid != 0;
+}
+
+// wait until every stage exited or the time is up, the stages are collected by the caller
+void waitDeadline(Deadline *deadline) {
+    if (deadline->timer < 0 || deadline->expired) {
+        return;
+    }
+    // a pidfd of a stage becomes readable when it exits
+    struct pollfd *fds = malloc((deadline->numIds + 1) * sizeof(struct pollfd));
+    fds[0].fd = deadline->timer;
+    fds[0].events = POLLIN;
+    int numFds = 1;
+    int hasPidfds = 1;
+    for (int i = 0; i < deadline->numIds; i++) {
+        if (deadline->ids[i] <= 0) {
+            continue;
+        }
+        int pidfd = (int) syscall(SYS_pidfd_open, deadline->ids[i], 0);
+        if (pidfd < 0) {
+            hasPidfds = 0;
+            break;
+        }
+        fds[numFds].fd = pidfd;
+        fds[numFds].events = POLLIN;
+        numFds++;
+    }
+    int numRunning = numFds - 1;
+    while (!deadline->expired && (hasPidfds ? numRunning > 0 : 1)) {
+        // without pidfds the stages are checked every few milliseconds
+        if (poll(fds, hasPidfds ? numFds : 1, hasPidfds ? -1 : 10) < 0 && errno != EINTR) {
+            break;
+        }
+        checkDeadline(deadline);
+        if (!hasPidfds) {
+            int running = 0;
+            for (int i = 0; i < deadline->numIds; i++) {
+                if (deadline->ids[i] > 0 && !hasStageExited(deadline->ids[i])) {
+                    running = 1;
+                    break;
+                }
+            }
+            if (!running) {
+                break;
+            }
+            continue;
+        }
+        for (int i = 1; i < numFds; i++) {
+            if (fds[i].fd >= 0 && (fds[i].revents & POLLIN)) {
+                close(fds[i].fd);
+                // poll ignores negative descriptors
+                fds[i].fd = -1;
+                numRunning--;
+            }
+        }
+    }
+    for (int i = 1; i < numFds; i++) {
+        if (fds[i].fd >= 0) {
+            close(fds[i].fd);
+        }
+    }
+    free(fds);
+}
+
+// stop the timer
+void stopDeadline(Deadline *deadline) {
+    if (deadline->timer >= 0) {
+        close(deadline->timer);
+        deadline->timer = -1;
+    }
+    interruptedGroup = -1;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <unistd.h>
+
+// exit statuses of a pipeline run with timeout, they follow coreutils
+#define TIMEOUT_EXPIRED_STATUS 124
+#define TIMEOUT_USAGE_STATUS 125
+#define TIMEOUT_KILLED_STATUS 137
+
+// structure for the time limit of a pipeline
+typedef struct Deadline {
+    // a timerfd that becomes readable when the time is up, -1 if the pipeline has no limit
+    int timer;
+    int signal;
+    // the process group of the stages, -1 if they are signalled one by one
+    pid_t processGroup;
+    pid_t *ids;
+    int numIds;
+    int expired;
+} Deadline;
+
+long long parseDuration(char *value);
+int parseSignal(char *value);
+void initDeadline(Deadline *deadline);
+int startDeadline(Deadline *deadline, long long milliseconds, int signal);
+void setDeadlineStages(Deadline *deadline, pid_t processGroup, pid_t *ids, int numIds);
+void checkDeadline(Deadline *deadline);
+void waitDeadline(Deadline *deadline);
+void stopDeadline(Deadline *deadline);
+
+#endif
\ No newline at end of file
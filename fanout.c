@@ -0,0 +1,462 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "fanout.h"
+#include "usage.h"
+#include "launch.h"
+#include "list.h"
+#include "reap.h"
+#include "pathcache.h"
+#include "parallel.h"
+#include "profile.h"
+
+extern int *status;
+extern BackgroundList *backgroundList;
+extern PathCache *pathCache;
+extern void printColor(char *color, char *msg);
+
+// the fan-outs that still have workers, background ones are driven by the child reaper
+FanoutRun *fanoutRuns = NULL;
+
+// find where the items given as arguments start, -1 if they are read from stdin
+int findFanoutSeparator(Command *command) {
+    for (int i = 0; i < command->commandArgs->numArgs; i++) {
+        if (strcmp(command->commandArgs->args[i], ":::") == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// check if a command is a fan-out that reads its items from stdin
+int fanoutReadsInput(Command *command) {
+    return command->builtInCommand == BIC_FANOUT && findFanoutSeparator(command) == -1;
+}
+
+// add an item to a fan-out
+void addFanoutItem(FanoutRun *run, char *value, size_t len, int *capacity) {
+    if (run->numItems == *capacity) {
+        *capacity = *capacity == 0 ? 16 : *capacity * 2;
+        run->items = realloc(run->items, *capacity * sizeof(FanoutItem));
+    }
+    FanoutItem *item = &run->items[run->numItems++];
+    item->value = strndup(value, len);
+    item->state = FS_WAITING;
+    item->pid = 0;
+    item->output = -1;
+    item->error = -1;
+    item->status = 0;
+}
+
+// read the items from stdin, one per line
+void readFanoutItems(FanoutRun *run, int *capacity) {
+    size_t size = 0, used = 0;
+    char *data = NULL;
+    while (1) {
+        if (used == size) {
+            size = size == 0 ? 4096 : size * 2;
+            data = realloc(data, size);
+        }
+        ssize_t len = read(STDIN_FILENO, data + used, size - used);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+        used += len;
+    }
+    size_t start = 0;
+    for (size_t i = 0; i <= used; i++) {
+        if (i == used || data[i] == '\n') {
+            if (i > start) {
+                addFanoutItem(run, data + start, i - start, capacity);
+            }
+            start = i + 1;
+        }
+    }
+    free(data);
+}
+
+// free a fan-out
+void freeFanoutRun(FanoutRun *run) {
+    for (int i = 0; i < run->numItems; i++) {
+        free(run->items[i].value);
+        if (run->items[i].output != -1) {
+            close(run->items[i].output);
+        }
+        if (run->items[i].error != -1) {
+            close(run->items[i].error);
+        }
+    }
+    for (int i = 0; i < run->numArgs; i++) {
+        free(run->args[i]);
+    }
+    if (run->devNull != -1) {
+        close(run->devNull);
+    }
+    free(run->items);
+    free(run->args);
+    free(run->slotItems);
+    free(run->path);
+    free(run);
+}
+
+// create a fan-out from the arguments of the built-in, returns NULL and sets the status on errors
+FanoutRun *createFanoutRun(Command *command) {
+    char **args = command->commandArgs->args;
+    int numArgs = command->commandArgs->numArgs;
+    int limit = 0, keepOrder = 0, buffered = 1, failFast = 0;
+    int i = 0;
+    for (; i < numArgs && args[i][0] == '-'; i++) {
+        if (strcmp(args[i], "--") == 0) {
+            i++;
+            break;
+        }
+        if (strcmp(args[i], "-k") == 0) {
+            keepOrder = 1;
+        } else if (strcmp(args[i], "-u") == 0) {
+            buffered = 0;
+        } else if (strcmp(args[i], "-f") == 0) {
+            failFast = 1;
+        } else if (strncmp(args[i], "-j", 2) == 0) {
+            char *value = args[i][2] != '\0' ? args[i] + 2 : (i + 1 < numArgs ? args[++i] : "");
+            char *endPtr = NULL;
+            limit = (int) strtol(value, &endPtr, 10);
+            if (endPtr == value || *endPtr != '\0' || limit < 1) {
+                printColor("\033[0;31m", "Error: invalid number of workers provided!\n");
+                *status = 2;
+                return NULL;
+            }
+        } else {
+            printColor("\033[0;31m", "Error: invalid option provided!\n");
+            *status = 2;
+            return NULL;
+        }
+    }
+    int separator = findFanoutSeparator(command);
+    int end = separator == -1 ? numArgs : separator;
+    if (i >= end) {
+        printColor("\033[0;31m", "Error: fanout requires a command!\n");
+        *status = 2;
+        return NULL;
+    }
+    // find the command once, every worker runs the same program
+    char *path = lookupCommandPath(pathCache, args[i]);
+    if (path == NULL) {
+        printColor("\033[0;31m", "Error: command not found!\n");
+        *status = 127;
+        return NULL;
+    }
+    // ordered output has to wait for earlier items, so it is always buffered
+    if (keepOrder) {
+        buffered = 1;
+    }
+    if (limit == 0) {
+        limit = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (limit < 1) {
+            limit = 1;
+        }
+    }
+
+    FanoutRun *run = calloc(1, sizeof(FanoutRun));
+    run->path = strdup(path);
+    run->numArgs = end - i;
+    run->args = malloc(run->numArgs * sizeof(char *));
+    run->appendItem = 1;
+    for (int j = 0; j < run->numArgs; j++) {
+        run->args[j] = strdup(args[i + j]);
+        if (strstr(run->args[j], "{}") != NULL) {
+            run->appendItem = 0;
+        }
+    }
+    int capacity = 0;
+    if (separator == -1) {
+        readFanoutItems(run, &capacity);
+    } else {
+        for (int j = separator + 1; j < numArgs; j++) {
+            addFanoutItem(run, args[j], strlen(args[j]), &capacity);
+        }
+    }
+    run->limit = limit < run->numItems ? limit : (run->numItems > 0 ? run->numItems : 1);
+    run->slotItems = malloc(run->limit * sizeof(int));
+    for (int j = 0; j < run->limit; j++) {
+        run->slotItems[j] = -1;
+    }
+    run->keepOrder = keepOrder;
+    run->buffered = buffered;
+    run->failFast = failFast;
+    run->failedItem = -1;
+    run->devNull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return run;
+}
+
+// replace the placeholders of an argument
+char *expandFanoutArg(char *arg, char *item, int slot) {
+    size_t itemLen = strlen(item);
+    size_t len = 0;
+    for (char *c = arg; *c != '\0'; ) {
+        if (strncmp(c, "{}", 2) == 0) {
+            len += itemLen;
+            c += 2;
+        } else if (strncmp(c, "{%}", 3) == 0) {
+            len += 12;
+            c += 3;
+        } else {
+            len++;
+            c++;
+        }
+    }
+    char *expanded = malloc(len + 1);
+    char *out = expanded;
+    for (char *c = arg; *c != '\0'; ) {
+        if (strncmp(c, "{}", 2) == 0) {
+            memcpy(out, item, itemLen);
+            out += itemLen;
+            c += 2;
+        } else if (strncmp(c, "{%}", 3) == 0) {
+            out += sprintf(out, "%d", slot + 1);
+            c += 3;
+        } else {
+            *out++ = *c++;
+        }
+    }
+    *out = '\0';
+    return expanded;
+}
+
+// start the worker of an item in a free slot
+void startFanoutItem(FanoutRun *run, int index, int slot) {
+    FanoutItem *item = &run->items[index];
+    int numArgs = run->numArgs + run->appendItem;
+    char **argv = malloc((numArgs + 1) * sizeof(char *));
+    for (int i = 0; i < run->numArgs; i++) {
+        argv[i] = expandFanoutArg(run->args[i], item->value, slot);
+    }
+    if (run->appendItem) {
+        argv[numArgs - 1] = strdup(item->value);
+    }
+    argv[numArgs] = NULL;
+
+    SpawnPlan plan;
+    initSpawnPlan(&plan);
+    addSpawnDefaultSignal(&plan, SIGCHLD);
+    addSpawnDefaultSignal(&plan, SIGINT);
+    // the workers run at the same time, so none of them can read the shell's input
+    if (run->devNull != -1) {
+        addSpawnDup2(&plan, run->devNull, STDIN_FILENO);
+    }
+    if (run->buffered) {
+        item->output = memfd_create("fanout-output", MFD_CLOEXEC);
+        item->error = memfd_create("fanout-error", MFD_CLOEXEC);
+        if (item->output < 0 || item->error < 0) {
+            printColor("\033[0;31m", "Error: the output of a fanout could not be captured!\n");
+            exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
+        }
+        addSpawnDup2(&plan, item->output, STDOUT_FILENO);
+        addSpawnDup2(&plan, item->error, STDERR_FILENO);
+    }
+
+    long long start = startProfileSpan();
+    item->pid = spawnProcess(&plan, run->path, argv);
+    endProfileSpan(PF_SPAWN, start, run->args[0]);
+    if (item->pid < 0) {
+        if (errno == EAGAIN || errno == ENOMEM) {
+            printColor("\033[0;31m", "Error: fork() could not create a child process!\n");
+            exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
+        }
+        // the item fails without a worker
+        item->state = FS_FINISHED;
+        item->status = 127;
+    } else {
+        item->state = FS_RUNNING;
+        run->slotItems[slot] = index;
+        run->numRunning++;
+
+        // the workers are jobs of the shell, so jobs and kill see them
+        size_t len = 7;
+        for (int i = 0; i < numArgs; i++) {
+            len += strlen(argv[i]) + 1;
+        }
+        char *commandLine = malloc(len);
+        strcpy(commandLine, "fanout");
+        for (int i = 0; i < numArgs; i++) {
+            strcat(commandLine, " ");
+            strcat(commandLine, argv[i]);
+        }
+        addBackgroundProcess(backgroundList, item->pid, commandLine);
+        free(commandLine);
+    }
+    for (int i = 0; i < numArgs; i++) {
+        free(argv[i]);
+    }
+    free(argv);
+}
+
+// check if a fan-out stopped starting items after a failure
+int isFanoutStopped(FanoutRun *run) {
+    return run->failFast && run->failedItem != -1;
+}
+
+// write the output of an item to the shell's output
+void flushFanoutItem(FanoutItem *item) {
+    if (item->state == FS_FINISHED && item->output != -1) {
+        copyCapturedOutput(item->output, STDOUT_FILENO);
+        copyCapturedOutput(item->error, STDERR_FILENO);
+        item->output = -1;
+        item->error = -1;
+    }
+    item->state = FS_FLUSHED;
+}
+
+// write finished output, start items in free slots, returns whether the fan-out is done
+int advanceFanoutRun(FanoutRun *run) {
+    if (!run->keepOrder) {
+        for (int i = run->numFlushed; i < run->nextItem; i++) {
+            if (run->items[i].state == FS_FINISHED) {
+                flushFanoutItem(&run->items[i]);
+            }
+        }
+    }
+    // items that will not start are passed over
+    while (run->numFlushed < run->numItems) {
+        FanoutItem *item = &run->items[run->numFlushed];
+        if (item->state == FS_FINISHED || (item->state == FS_WAITING && isFanoutStopped(run))) {
+            flushFanoutItem(item);
+        } else if (item->state != FS_FLUSHED) {
+            break;
+        }
+        run->numFlushed++;
+    }
+
+    for (int slot = 0; slot < run->limit && !isFanoutStopped(run); slot++) {
+        if (run->slotItems[slot] != -1 || run->nextItem == run->numItems) {
+            continue;
+        }
+        int index = run->nextItem++;
+        startFanoutItem(run, index, slot);
+        if (run->items[index].state == FS_FINISHED) {
+            // the worker did not start, so the slot is still free
+            if (run->failedItem == -1) {
+                run->failedItem = index;
+            }
+            slot--;
+        }
+    }
+    if (run->numRunning == 0 && run->numFlushed < run->numItems) {
+        // only failed launches are left to report
+        return advanceFanoutRun(run);
+    }
+    return run->numRunning == 0;
+}
+
+// remove a fan-out from the fan-outs with workers
+void unlinkFanoutRun(FanoutRun *run) {
+    for (FanoutRun **link = &fanoutRuns; *link != NULL; link = &(*link)->next) {
+        if (*link == run) {
+            *link = run->next;
+            return;
+        }
+    }
+}
+
+// handle a finished child, returns whether it was a worker of a fan-out
+int collectFanoutWorker(pid_t pid, int workerStatus) {
+    for (FanoutRun *run = fanoutRuns; run != NULL; run = run->next) {
+        for (int slot = 0; slot < run->limit; slot++) {
+            int index = run->slotItems[slot];
+            if (index == -1 || run->items[index].pid != pid) {
+                continue;
+            }
+            FanoutItem *item = &run->items[index];
+            item->state = FS_FINISHED;
+            item->status = WIFEXITED(workerStatus) ? WEXITSTATUS(workerStatus) : 128 + WTERMSIG(workerStatus);
+            run->slotItems[slot] = -1;
+            run->numRunning--;
+            if (item->status != 0 && (run->failedItem == -1 || (!run->failFast && index < run->failedItem))) {
+                run->failedItem = index;
+                if (run->failFast) {
+                    // stop the items that are still running
+                    for (int i = 0; i < run->limit; i++) {
+                        if (run->slotItems[i] != -1) {
+                            kill(run->items[run->slotItems[i]].pid, SIGTERM);
+                        }
+                    }
+                }
+            }
+            if (advanceFanoutRun(run) && run->background) {
+                unlinkFanoutRun(run);
+                freeFanoutRun(run);
+            }
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// wait for a child of the shell and pass it to its fan-out or the job table
+int waitFanoutChild() {
+    int workerStatus;
+    pid_t pid = waitpid(-1, &workerStatus, 0);
+    if (pid < 0) {
+        return errno == EINTR;
+    }
+    removeBackgroundProcessByPID(backgroundList, pid, workerStatus);
+    collectFanoutWorker(pid, workerStatus);
+    return 1;
+}
+
+// run a command for every item, in the background the workers are driven by the child reaper
+void runFanout(Command *command, int background) {
+    FanoutRun *run = createFanoutRun(command);
+    if (run == NULL) {
+        return;
+    }
+    run->background = background;
+    run->next = fanoutRuns;
+    fanoutRuns = run;
+    if (background) {
+        if (advanceFanoutRun(run)) {
+            unlinkFanoutRun(run);
+            freeFanoutRun(run);
+        }
+        *status = 0;
+        return;
+    }
+
+    // ignore the int signal in the shell, it stops the workers
+    struct sigaction sigint, previousSigint;
+    sigemptyset(&sigint.sa_mask);
+    sigint.sa_flags = SA_RESTART;
+    sigint.sa_handler = SIG_IGN;
+    sigaction(SIGINT, &sigint, &previousSigint);
+
+    pauseChildReaper(1);
+    if (!advanceFanoutRun(run)) {
+        while (run->numRunning > 0 && waitFanoutChild());
+    }
+    pauseChildReaper(0);
+    sigaction(SIGINT, &previousSigint, NULL);
+
+    *status = run->failedItem == -1 ? 0 : run->items[run->failedItem].status;
+    unlinkFanoutRun(run);
+    freeFanoutRun(run);
+}
+
+// finish the background fan-outs before the shell stops
+void waitFanoutRuns() {
+    while (fanoutRuns != NULL && waitFanoutChild());
+    while (fanoutRuns != NULL) {
+        FanoutRun *run = fanoutRuns;
+        fanoutRuns = run->next;
+        freeFanoutRun(run);
+    }
+}
\ No newline at end of file
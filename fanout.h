@@ -0,0 +1,58 @@
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <unistd.h>
+
+#include "structs.h"
+
+// states of an item of a fan-out
+typedef enum FanoutState {
+    FS_WAITING,
+    FS_RUNNING,
+    FS_FINISHED,
+    FS_FLUSHED
+} FanoutState;
+
+// structure for an input item and the worker that runs the command for it
+typedef struct FanoutItem {
+    char *value;
+    FanoutState state;
+    pid_t pid;
+    // the captured stdout and stderr of the worker, -1 if it writes directly
+    int output;
+    int error;
+    int status;
+} FanoutItem;
+
+// structure for a command that runs once per item on a limited number of worker slots
+typedef struct FanoutRun {
+    char *path;
+    // the arguments of the command, {} is replaced by the item and {%} by the slot
+    char **args;
+    int numArgs;
+    int appendItem;
+    FanoutItem *items;
+    int numItems;
+    int nextItem;
+    int numFlushed;
+    // the item that runs in each slot, -1 if the slot is free
+    int *slotItems;
+    int limit;
+    int numRunning;
+    // options: output in the order of the items, output per item, stop at the first failure
+    int keepOrder;
+    int buffered;
+    int failFast;
+    // the first item that failed, -1 if none did
+    int failedItem;
+    int background;
+    int devNull;
+    struct FanoutRun *next;
+} FanoutRun;
+
+int fanoutReadsInput(Command *command);
+void runFanout(Command *command, int background);
+int collectFanoutWorker(pid_t pid, int workerStatus);
+void waitFanoutRuns();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "fileset.h"
+
+// create a set with room for the given number of files
+void initFileSet(FileSet *set, int numFiles) {
+    // the set is at most half full, so probing stays short
+    set->numBuckets = 8;
+    while (set->numBuckets < 2 * numFiles) {
+        set->numBuckets *= 2;
+    }
+    set->entries = calloc(set->numBuckets, sizeof(FileIdentity));
+}
+
+// hash the identity of a file
+unsigned int hashFileIdentity(dev_t device, ino_t inode) {
+    unsigned long long key = (unsigned long long) inode * 0x9e3779b97f4a7c15ull ^ (unsigned long long) device;
+    return (unsigned int) (key ^ (key >> 32));
+}
+
+// find the entry of a file, or the empty entry where it goes
+FileIdentity *findFileIdentity(FileSet *set, dev_t device, ino_t inode) {
+    unsigned int mask = set->numBuckets - 1;
+    unsigned int index = hashFileIdentity(device, inode) & mask;
+    while (set->entries[index].roles != 0) {
+        FileIdentity *entry = &set->entries[index];
+        if (entry->device == device && entry->inode == inode) {
+            return entry;
+        }
+        index = (index + 1) & mask;
+    }
+    return &set->entries[index];
+}
+
+// add the identity of a file with its role
+void addIdentityToSet(FileSet *set, dev_t device, ino_t inode, FileRole role) {
+    FileIdentity *entry = findFileIdentity(set, device, inode);
+    entry->device = device;
+    entry->inode = inode;
+    entry->roles |= role;
+}
+
+// add an opened file with its role, other names for the same file end up in the same entry
+int addFileToSet(FileSet *set, int fd, FileRole role) {
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        return 0;
+    }
+    // only regular files can be truncated while they are read, terminals and pipes are shared freely
+    if (S_ISREG(info.st_mode)) {
+        addIdentityToSet(set, info.st_dev, info.st_ino, role);
+    }
+    return 1;
+}
+
+// add a file by its path with its role; a file that does not exist yet is identified by its
+// directory and its name, so ./a and a still end up in the same entry
+void addPathToSet(FileSet *set, char *path, FileRole role) {
+    struct stat info;
+    if (stat(path, &info) == 0) {
+        if (S_ISREG(info.st_mode)) {
+            addIdentityToSet(set, info.st_dev, info.st_ino, role);
+        }
+        return;
+    }
+    char *slash = strrchr(path, '/');
+    char *name = slash != NULL ? slash + 1 : path;
+    unsigned long long nameHash = 1469598103934665603ull;
+    for (char *c = name; *c != '\0'; c++) {
+        nameHash = (nameHash ^ (unsigned char) *c) * 1099511628211ull;
+    }
+    int found;
+    if (slash == NULL) {
+        found = stat(".", &info) == 0;
+    } else if (slash == path) {
+        found = stat("/", &info) == 0;
+    } else {
+        char *directory = strndup(path, slash - path);
+        found = stat(directory, &info) == 0;
+        free(directory);
+    }
+    // the keys of missing files can meet the keys of other files, which only makes them wait for each other
+    if (found) {
+        addIdentityToSet(set, info.st_dev, info.st_ino ^ nameHash, role);
+    } else {
+        addIdentityToSet(set, 0, nameHash, role);
+    }
+}
+
+// check if a file is used in both roles
+int hasFileSetConflict(FileSet *set, int firstRole, int secondRole) {
+    for (int i = 0; i < set->numBuckets; i++) {
+        if ((set->entries[i].roles & firstRole) && (set->entries[i].roles & secondRole)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// check if a file is in both sets with the role in at least one of them
+int hasSharedFile(FileSet *first, FileSet *second, int role) {
+    for (int i = 0; i < first->numBuckets; i++) {
+        FileIdentity *entry = &first->entries[i];
+        if (entry->roles == 0) {
+            continue;
+        }
+        FileIdentity *other = findFileIdentity(second, entry->device, entry->inode);
+        if (other->roles != 0 && ((entry->roles | other->roles) & role)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// free the set
+void freeFileSet(FileSet *set) {
+    free(set->entries);
+    set->entries = NULL;
+}
\ No newline at end of file
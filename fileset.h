@@ -0,0 +1,33 @@
+#ifndef FILESET_H
+#define FILESET_H
+
+#include <sys/types.h>
+
+// roles a file has in the redirections of a pipeline
+typedef enum FileRole {
+    FR_INPUT = 1,
+    FR_OUTPUT = 2,
+    FR_ERROR = 4
+} FileRole;
+
+// structure for a file identified by its device and inode, with the roles it is used in
+typedef struct FileIdentity {
+    dev_t device;
+    ino_t inode;
+    int roles;
+} FileIdentity;
+
+// structure for a hash set of the files of a pipeline
+typedef struct FileSet {
+    FileIdentity *entries;
+    int numBuckets;
+} FileSet;
+
+void initFileSet(FileSet *set, int numFiles);
+int addFileToSet(FileSet *set, int fd, FileRole role);
+void addPathToSet(FileSet *set, char *path, FileRole role);
+int hasFileSetConflict(FileSet *set, int firstRole, int secondRole);
+int hasSharedFile(FileSet *first, FileSet *second, int role);
+void freeFileSet(FileSet *set);
+
+#endif
\ No newline at end of file
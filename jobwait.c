@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "jobwait.h"
+#include "list.h"
+#include "reap.h"
+
+extern int *status;
+extern BackgroundList *backgroundList;
+extern void printColor(char *color, char *msg);
+
+// get the monotonic time in milliseconds
+long long waitNow() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000LL + time.tv_nsec / 1000000;
+}
+
+// print the exit status of a job that was waited for
+void reportFinishedJob(FinishedJob *job) {
+    fprintf(stdout, "Process with index %d finished with exit code %d\n", job->id, job->status);
+}
+
+// check if the waited jobs are finished, sets the status of wait when they are
+int collectWaitedJobs(int *ids, int *done, int numIds, int any) {
+    FinishedJob job;
+    if (numIds == 0) {
+        while (takeFinishedJob(backgroundList, -1, &job)) {
+            reportFinishedJob(&job);
+            if (any) {
+                *status = job.status;
+                return 1;
+            }
+        }
+        if (isEmptyBackgroundList(backgroundList)) {
+            // wait -n without any job has nothing to wait for
+            *status = any ? 127 : 0;
+            return 1;
+        }
+        return 0;
+    }
+    int numDone = 0;
+    for (int i = 0; i < numIds; i++) {
+        if (done[i] == -1 && takeFinishedJob(backgroundList, ids[i], &job)) {
+            reportFinishedJob(&job);
+            done[i] = job.status;
+            if (any) {
+                *status = job.status;
+                return 1;
+            }
+        } else if (done[i] == -1 && findBackgroundProcessByID(backgroundList, ids[i]) == NULL) {
+            // not a job, or one that finished so long ago that its status was forgotten
+            printColor("\033[0;31m", "Error: this index is not a background process!\n");
+            done[i] = 127;
+        }
+        numDone += done[i] != -1;
+    }
+    if (numDone == numIds) {
+        *status = done[numIds - 1];
+        return 1;
+    }
+    return 0;
+}
+
+// wait for background jobs: wait [id...] [-n] [-t timeout]
+// without ids all jobs are waited for, -n returns when the first one finishes,
+// -t gives up after the timeout in seconds with status 124
+void runWait(Command *command) {
+    int numArgs = command->commandArgs->numArgs;
+    int *ids = malloc((numArgs + 1) * sizeof(int));
+    int *done = malloc((numArgs + 1) * sizeof(int));
+    int numIds = 0;
+    int any = 0;
+    long long timeout = -1;
+    for (int i = 0; i < numArgs; i++) {
+        char *arg = command->commandArgs->args[i];
+        char *endPtr = NULL;
+        if (strcmp(arg, "-n") == 0) {
+            any = 1;
+        } else if (strcmp(arg, "-t") == 0) {
+            double seconds = i + 1 < numArgs ? strtod(command->commandArgs->args[i + 1], &endPtr) : -1;
+            if (endPtr == NULL || endPtr == command->commandArgs->args[i + 1] || *endPtr != '\0' || seconds < 0) {
+                printColor("\033[0;31m", "Error: invalid timeout provided!\n");
+                *status = 2;
+                free(ids);
+                free(done);
+                return;
+            }
+            timeout = (long long) (seconds * 1000);
+            i++;
+        } else {
+            int id = (int) strtol(arg, &endPtr, 10);
+            if (endPtr == arg || *endPtr != '\0') {
+                printColor("\033[0;31m", "Error: invalid index provided!\n");
+                *status = 2;
+                free(ids);
+                free(done);
+                return;
+            }
+            ids[numIds] = id;
+            done[numIds] = -1;
+            numIds++;
+        }
+    }
+
+    // the jobs are children of the shell, a subshell would wait for them forever
+    if (!canReapChildren()) {
+        printColor("\033[0;31m", "Error: wait can only be used in the shell!\n");
+        *status = 2;
+        free(ids);
+        free(done);
+        return;
+    }
+
+    // the jobs are collected through the signalfd of the child reaper, so waiting costs no cpu
+    long long deadline = timeout >= 0 ? waitNow() + timeout : -1;
+    reapChildren();
+    while (!collectWaitedJobs(ids, done, numIds, any)) {
+        int left = -1;
+        if (deadline != -1) {
+            long long remaining = deadline - waitNow();
+            if (remaining <= 0) {
+                *status = WAIT_TIMEOUT_STATUS;
+                break;
+            }
+            left = (int) remaining;
+        }
+        if (waitForChildren(left) < 0) {
+            if (errno == EINTR) {
+                // interrupted by a signal like SIGINT
+                *status = 130;
+            } else {
+                printColor("\033[0;31m", "Error: wait could not collect the jobs!\n");
+                *status = 2;
+            }
+            break;
+        }
+    }
+    free(ids);
+    free(done);
+}
\ No newline at end of file
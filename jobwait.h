@@ -0,0 +1,11 @@
+#ifndef JOBWAIT_H
+#define JOBWAIT_H
+
+#include "structs.h"
+
+// exit status of wait when the timeout runs out
+#define WAIT_TIMEOUT_STATUS 124
+
+void runWait(Command *command);
+
+#endif
\ No newline at end of file
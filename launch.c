@@ -0,0 +1,220 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "launch.h"
+
+extern char **environ;
+
+// the engine used to launch processes
+SpawnEngine spawnEngine = SE_POSIX_SPAWN;
+
+// choose the engine, SHELL_SPAWN=fork forces the fork fallback
+void initSpawnEngine() {
+    char *engine = getenv("SHELL_SPAWN");
+    if (engine != NULL && strcmp(engine, "fork") == 0) {
+        spawnEngine = SE_FORK;
+    } else {
+        spawnEngine = SE_POSIX_SPAWN;
+    }
+}
+
+// set the engine used to launch processes
+void setSpawnEngine(SpawnEngine engine) {
+    spawnEngine = engine;
+}
+
+// create an empty plan
+void initSpawnPlan(SpawnPlan *plan) {
+    plan->numActions = 0;
+    plan->overflowed = 0;
+    sigemptyset(&plan->defaultSignals);
+    plan->processGroup = -1;
+}
+
+// move fd to newFd in the child
+void addSpawnDup2(SpawnPlan *plan, int fd, int newFd) {
+    if (fd == newFd) {
+        return;
+    }
+    if (plan->numActions == SPAWN_MAX_ACTIONS) {
+        plan->overflowed = 1;
+        return;
+    }
+    plan->actions[plan->numActions].type = SA_DUP2;
+    plan->actions[plan->numActions].fd = fd;
+    plan->actions[plan->numActions].newFd = newFd;
+    plan->numActions++;
+}
+
+// close fd in the child
+void addSpawnClose(SpawnPlan *plan, int fd) {
+    if (plan->numActions == SPAWN_MAX_ACTIONS) {
+        plan->overflowed = 1;
+        return;
+    }
+    plan->actions[plan->numActions].type = SA_CLOSE;
+    plan->actions[plan->numActions].fd = fd;
+    plan->actions[plan->numActions].newFd = -1;
+    plan->numActions++;
+}
+
+// reset the handler of a signal in the child
+void addSpawnDefaultSignal(SpawnPlan *plan, int signo) {
+    sigaddset(&plan->defaultSignals, signo);
+}
+
+// put the child in a process group
+void setSpawnProcessGroup(SpawnPlan *plan, pid_t processGroup) {
+    plan->processGroup = processGroup;
+}
+
+// launch the process with fork, the exec error is sent back through a pipe
+pid_t forkProcess(SpawnPlan *plan, char *file, char **argv) {
+    int report[2];
+    if (pipe2(report, O_CLOEXEC) < 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        int forkError = errno;
+        close(report[0]);
+        close(report[1]);
+        errno = forkError;
+        return -1;
+    } else if (pid == 0) {
+        if (plan->processGroup >= 0) {
+            setpgid(0, plan->processGroup);
+        }
+        // reset the signal handlers
+        struct sigaction sigdefault;
+        sigemptyset(&sigdefault.sa_mask);
+        sigdefault.sa_flags = SA_RESTART;
+        sigdefault.sa_handler = SIG_DFL;
+        for (int signo = 1; signo < NSIG; signo++) {
+            if (sigismember(&plan->defaultSignals, signo) == 1) {
+                sigaction(signo, &sigdefault, NULL);
+            }
+        }
+        // the shell blocks SIGCHLD, commands start without blocked signals
+        sigset_t emptyMask;
+        sigemptyset(&emptyMask);
+        sigprocmask(SIG_SETMASK, &emptyMask, NULL);
+        // apply the file actions in order
+        for (int i = 0; i < plan->numActions; i++) {
+            if (plan->actions[i].type == SA_DUP2) {
+                dup2(plan->actions[i].fd, plan->actions[i].newFd);
+            } else {
+                close(plan->actions[i].fd);
+            }
+        }
+        execv(file, argv);
+        int execError = errno;
+        write(report[1], &execError, sizeof(int));
+        _exit(127);
+    }
+
+    // set the group from both sides, so the next stage can join it whichever runs first
+    if (plan->processGroup >= 0) {
+        setpgid(pid, plan->processGroup == 0 ? pid : plan->processGroup);
+    }
+    close(report[1]);
+    int execError = 0;
+    ssize_t len;
+    while ((len = read(report[0], &execError, sizeof(int))) < 0 && errno == EINTR);
+    close(report[0]);
+    if (len == sizeof(int)) {
+        // the child could not exec, collect it
+        waitpid(pid, NULL, 0);
+        errno = execError;
+        return -1;
+    }
+    return pid;
+}
+
+// launch the process with posix_spawn, which uses clone(CLONE_VM|CLONE_VFORK)
+pid_t posixSpawnProcess(SpawnPlan *plan, char *file, char **argv) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attributes);
+
+    for (int i = 0; i < plan->numActions; i++) {
+        if (plan->actions[i].type == SA_DUP2) {
+            posix_spawn_file_actions_adddup2(&actions, plan->actions[i].fd, plan->actions[i].newFd);
+        } else {
+            posix_spawn_file_actions_addclose(&actions, plan->actions[i].fd);
+        }
+    }
+    posix_spawnattr_setsigdefault(&attributes, &plan->defaultSignals);
+    // the shell blocks SIGCHLD, commands start without blocked signals
+    sigset_t emptyMask;
+    sigemptyset(&emptyMask);
+    posix_spawnattr_setsigmask(&attributes, &emptyMask);
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    if (plan->processGroup >= 0) {
+        posix_spawnattr_setpgroup(&attributes, plan->processGroup);
+        flags |= POSIX_SPAWN_SETPGROUP;
+    }
+    posix_spawnattr_setflags(&attributes, flags);
+
+    pid_t pid;
+    int spawnError = posix_spawn(&pid, file, &actions, &attributes, argv, environ);
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (spawnError != 0) {
+        errno = spawnError;
+        return -1;
+    }
+    return pid;
+}
+
+// launch a process following the plan
+pid_t launchProcess(SpawnPlan *plan, char *file, char **argv) {
+    if (spawnEngine == SE_POSIX_SPAWN) {
+        pid_t pid = posixSpawnProcess(plan, file, argv);
+        // fall back to fork if the plan cannot be expressed by posix_spawn
+        if (pid >= 0 || (errno != ENOSYS && errno != EINVAL)) {
+            return pid;
+        }
+    }
+    return forkProcess(plan, file, argv);
+}
+
+// launch the file at the given path following the plan, returns -1 and sets errno on failure
+pid_t spawnProcess(SpawnPlan *plan, char *file, char **argv) {
+    // a child missing some of its file actions would run with the wrong fds
+    if (plan->overflowed) {
+        errno = E2BIG;
+        return -1;
+    }
+    pid_t pid = launchProcess(plan, file, argv);
+    if (pid >= 0 || errno != ENOEXEC) {
+        return pid;
+    }
+    // like execvp, run files without a known format as shell scripts
+    int numArgs = 0;
+    while (argv[numArgs] != NULL) {
+        numArgs++;
+    }
+    char **shellArgv = malloc((numArgs + 2) * sizeof(char *));
+    shellArgv[0] = "/bin/sh";
+    shellArgv[1] = file;
+    for (int i = 1; i <= numArgs; i++) {
+        shellArgv[i + 1] = argv[i];
+    }
+    pid = launchProcess(plan, "/bin/sh", shellArgv);
+    int spawnError = errno;
+    free(shellArgv);
+    errno = spawnError;
+    return pid;
+}
\ No newline at end of file
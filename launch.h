@@ -0,0 +1,50 @@
+#ifndef LAUNCH_H
+#define LAUNCH_H
+
+#include <unistd.h>
+#include <signal.h>
+
+// maximum number of file actions in a spawn plan
+#define SPAWN_MAX_ACTIONS 16
+
+// types of process launch engines
+typedef enum SpawnEngine {
+    SE_POSIX_SPAWN,
+    SE_FORK
+} SpawnEngine;
+
+// types of file actions
+typedef enum SpawnActionType {
+    SA_DUP2,
+    SA_CLOSE
+} SpawnActionType;
+
+// structure for a file action
+typedef struct SpawnAction {
+    SpawnActionType type;
+    int fd;
+    int newFd;
+} SpawnAction;
+
+// structure for the setup of a child process
+typedef struct SpawnPlan {
+    SpawnAction actions[SPAWN_MAX_ACTIONS];
+    int numActions;
+    // set when an action did not fit, such a plan is never launched
+    int overflowed;
+    sigset_t defaultSignals;
+    // the process group to join, 0 for a new group led by the child, -1 to stay in the group of the shell
+    pid_t processGroup;
+} SpawnPlan;
+
+void initSpawnEngine();
+void setSpawnEngine(SpawnEngine engine);
+
+void initSpawnPlan(SpawnPlan *plan);
+void addSpawnDup2(SpawnPlan *plan, int fd, int newFd);
+void addSpawnClose(SpawnPlan *plan, int fd);
+void addSpawnDefaultSignal(SpawnPlan *plan, int signo);
+void setSpawnProcessGroup(SpawnPlan *plan, pid_t processGroup);
+pid_t spawnProcess(SpawnPlan *plan, char *file, char **argv);
+
+#endif
\ No newline at end of file
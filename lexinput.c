@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "lexinput.h"
+#include "reap.h"
+#include "profile.h"
+
+// whether the input is a regular file that is read in blocks, -1 until the first read
+int blockInput = -1;
+int fileInput = 0;
+// the last block of a script file, the lexer gets one line of it at a time, so it never holds more
+// than the rest of the line it scans; the block starts at blockOffset in the file
+char inputBlock[LEXER_BLOCK_SIZE];
+int blockStart = 0;
+int blockEnd = 0;
+off_t blockOffset = 0;
+// the position in the file the next block is read from
+off_t nextOffset = 0;
+// the position the input was given back at, -1 while the lexer reads it
+off_t releasedOffset = -1;
+
+// find out how the input is read, SHELL_INPUT=byte reads files one byte at a time like terminals and
+// pipes, which bench/lexinput compares against
+void detectLexerInput() {
+    struct stat info;
+    char *mode = getenv("SHELL_INPUT");
+    fileInput = fstat(STDIN_FILENO, &info) == 0 && S_ISREG(info.st_mode);
+    blockInput = fileInput && (mode == NULL || strcmp(mode, "byte") != 0);
+    if (blockInput) {
+        nextOffset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+        blockOffset = nextOffset;
+    }
+}
+
+// read from the input, retrying when a signal interrupts the read
+ssize_t readInput(char *buffer, size_t size) {
+    long long start = startProfileSpan();
+    ssize_t len;
+    do {
+        len = read(STDIN_FILENO, buffer, size);
+    } while (len < 0 && errno == EINTR);
+    endProfileSpan(PF_INPUT, start, NULL);
+    return len;
+}
+
+// give the lexer the next line of its input, terminals and pipes are read one byte at a time, so
+// nothing after the line is taken from commands that read the same input
+int readLexerInput(char *buffer, int maxSize) {
+    if (blockInput == -1) {
+        detectLexerInput();
+    }
+    if (!blockInput) {
+        // finished background processes are collected while the shell waits for input
+        if (fileInput) {
+            reapChildren();
+        } else {
+            waitForInput(STDIN_FILENO);
+        }
+        int len = 0;
+        while (len < maxSize && readInput(buffer + len, 1) > 0) {
+            if (buffer[len++] == '\n') {
+                break;
+            }
+        }
+        return len;
+    }
+    if (blockStart == blockEnd) {
+        reapChildren();
+        ssize_t len = readInput(inputBlock, LEXER_BLOCK_SIZE);
+        if (len <= 0) {
+            return 0;
+        }
+        blockOffset = nextOffset;
+        nextOffset += len;
+        blockStart = 0;
+        blockEnd = len;
+    }
+    int len = blockEnd - blockStart < maxSize ? blockEnd - blockStart : maxSize;
+    char *newline = memchr(inputBlock + blockStart, '\n', len);
+    if (newline != NULL) {
+        len = newline - (inputBlock + blockStart) + 1;
+    }
+    memcpy(buffer, inputBlock + blockStart, len);
+    blockStart += len;
+    return len;
+}
+
+// seek the input back to the end of the line the lexer has, so commands read the script from the next line
+// like they do when it is read one byte at a time
+void releaseLexerInput() {
+    if (blockInput != 1) {
+        return;
+    }
+    releasedOffset = blockOffset + blockStart;
+    if (blockStart < blockEnd) {
+        lseek(STDIN_FILENO, releasedOffset, SEEK_SET);
+    }
+}
+
+// continue reading after the commands, the rest of the block is only dropped if they used the input
+void reclaimLexerInput() {
+    if (releasedOffset == -1) {
+        return;
+    }
+    off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (offset == releasedOffset) {
+        if (blockStart < blockEnd) {
+            lseek(STDIN_FILENO, nextOffset, SEEK_SET);
+        }
+    } else if (offset != -1) {
+        // the next line is the one after what the commands read
+        blockStart = 0;
+        blockEnd = 0;
+        nextOffset = offset;
+        blockOffset = offset;
+    }
+    releasedOffset = -1;
+}
+
+// get the position in the input the lexer has reached
+off_t lexerInputOffset() {
+    if (blockInput == 1) {
+        return blockOffset + blockStart;
+    }
+    return lseek(STDIN_FILENO, 0, SEEK_CUR);
+}
+
+// forget the rest of the block and read from the current position of the input
+void resetLexerInput() {
+    blockStart = 0;
+    blockEnd = 0;
+    releasedOffset = -1;
+    if (blockInput == 1) {
+        nextOffset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+        blockOffset = nextOffset;
+    }
+}
\ No newline at end of file
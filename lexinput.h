@@ -0,0 +1,15 @@
+#ifndef LEXINPUT_H
+#define LEXINPUT_H
+
+#include <sys/types.h>
+
+// the size of the blocks a script file is read in
+#define LEXER_BLOCK_SIZE 65536
+
+int readLexerInput(char *buffer, int maxSize);
+void releaseLexerInput();
+void reclaimLexerInput();
+off_t lexerInputOffset();
+void resetLexerInput();
+
+#endif
\ No newline at end of file
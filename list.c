@@ -1,108 +1,335 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
 
 #include "list.h"
 
+// marks the end of a chain of slots
+#define NO_SLOT -1
+
+// get the bucket of a pid or an id
+unsigned int hashBackgroundKey(int key, int numBuckets) {
+    return ((unsigned int) key * 2654435761u) & (numBuckets - 1);
+}
+
 // create a new list
 BackgroundList *createBackgroundList() {
     BackgroundList *list = malloc(sizeof(BackgroundList));
-    list->head = NULL;
-    list->tail = NULL;
+    list->numSlots = 0;
+    list->slots = NULL;
+    list->freeSlot = NO_SLOT;
+    list->head = NO_SLOT;
+    list->tail = NO_SLOT;
     list->lastId = 1;
+    list->numBuckets = 0;
+    list->idBuckets = NULL;
+    list->numProcesses = 0;
+    list->members = NULL;
+    list->numMemberSlots = 0;
+    list->freeMember = NO_SLOT;
+    list->pidBuckets = NULL;
+    list->numPidBuckets = 0;
+    list->firstFinished = 0;
+    list->numFinished = 0;
     return list;
 }
 
-// add a new process to the list
-void addBackgroundProcess(BackgroundList *list, pid_t pid) {
-    BackgroundProcess *process = malloc(sizeof(BackgroundProcess));
-    process->id = list->lastId++;
+// put a slot in the id table
+void insertBackgroundProcess(BackgroundList *list, int slot) {
+    BackgroundProcess *process = &list->slots[slot];
+    unsigned int idBucket = hashBackgroundKey(process->id, list->numBuckets);
+    process->nextById = list->idBuckets[idBucket];
+    list->idBuckets[idBucket] = slot;
+}
+
+// double the slots and the tables when they are full
+void growBackgroundList(BackgroundList *list) {
+    int numSlots = list->numSlots == 0 ? 64 : list->numSlots * 2;
+    list->slots = realloc(list->slots, numSlots * sizeof(BackgroundProcess));
+    // the new slots are free, in order so the lowest is used first
+    for (int slot = numSlots - 1; slot >= list->numSlots; slot--) {
+        list->slots[slot].commandLine = NULL;
+        list->slots[slot].commandLineCapacity = 0;
+        list->slots[slot].next = list->freeSlot;
+        list->freeSlot = slot;
+    }
+    list->numSlots = numSlots;
+
+    free(list->idBuckets);
+    list->numBuckets = numSlots * 2;
+    list->idBuckets = malloc(list->numBuckets * sizeof(int));
+    memset(list->idBuckets, 0xff, list->numBuckets * sizeof(int));
+    for (int slot = list->head; slot != NO_SLOT; slot = list->slots[slot].next) {
+        insertBackgroundProcess(list, slot);
+    }
+}
+
+// double the members and the pid table when they are full
+void growBackgroundMembers(BackgroundList *list) {
+    int numMembers = list->numMemberSlots == 0 ? 64 : list->numMemberSlots * 2;
+    list->members = realloc(list->members, numMembers * sizeof(BackgroundMember));
+    for (int member = numMembers - 1; member >= list->numMemberSlots; member--) {
+        list->members[member].nextByPid = list->freeMember;
+        list->freeMember = member;
+    }
+
+    free(list->pidBuckets);
+    list->numPidBuckets = numMembers * 2;
+    list->pidBuckets = malloc(list->numPidBuckets * sizeof(int));
+    memset(list->pidBuckets, 0xff, list->numPidBuckets * sizeof(int));
+    // the table only grows when no member is free, so all the old members are in use
+    for (int member = 0; member < list->numMemberSlots; member++) {
+        unsigned int bucket = hashBackgroundKey(list->members[member].pid, list->numPidBuckets);
+        list->members[member].nextByPid = list->pidBuckets[bucket];
+        list->pidBuckets[bucket] = member;
+    }
+    list->numMemberSlots = numMembers;
+}
+
+// add a process to the job in a slot
+void addBackgroundMember(BackgroundList *list, int slot, pid_t pid) {
+    if (list->freeMember == NO_SLOT) {
+        growBackgroundMembers(list);
+    }
+    int member = list->freeMember;
+    BackgroundMember *process = &list->members[member];
+    list->freeMember = process->nextByPid;
+
     process->pid = pid;
-    process->next = NULL;
-    if (list->head == NULL) {
-        list->head = process;
+    process->slot = slot;
+    unsigned int bucket = hashBackgroundKey(pid, list->numPidBuckets);
+    process->nextByPid = list->pidBuckets[bucket];
+    list->pidBuckets[bucket] = member;
+    process->nextInJob = list->slots[slot].firstMember;
+    list->slots[slot].firstMember = member;
+    list->slots[slot].numMembers++;
+}
+
+// unlink a member from the pid table and free it
+void removeBackgroundMember(BackgroundList *list, int member) {
+    int *link = &list->pidBuckets[hashBackgroundKey(list->members[member].pid, list->numPidBuckets)];
+    while (*link != member) {
+        link = &list->members[*link].nextByPid;
+    }
+    *link = list->members[member].nextByPid;
+    list->members[member].nextByPid = list->freeMember;
+    list->freeMember = member;
+}
+
+// find the member of a PID
+int findBackgroundMember(BackgroundList *list, pid_t pid) {
+    if (list->numPidBuckets == 0) {
+        return NO_SLOT;
+    }
+    int member = list->pidBuckets[hashBackgroundKey(pid, list->numPidBuckets)];
+    while (member != NO_SLOT && list->members[member].pid != pid) {
+        member = list->members[member].nextByPid;
+    }
+    return member;
+}
+
+// copy the command line into the buffer of a slot, it only grows for a line longer than before
+void setCommandLine(BackgroundProcess *process, char *commandLine) {
+    if (commandLine == NULL) {
+        commandLine = "";
+    }
+    size_t len = strlen(commandLine) + 1;
+    if (len > process->commandLineCapacity) {
+        process->commandLineCapacity = len < 64 ? 64 : len;
+        process->commandLine = realloc(process->commandLine, process->commandLineCapacity);
+    }
+    memcpy(process->commandLine, commandLine, len);
+}
+
+// add a new job of one or more processes to the list, the last stage is the position of the last stage of the
+// pipeline in the processes or -1 if it did not start, a process group of -1 means the shell's own
+void addBackgroundJob(BackgroundList *list, pid_t *pids, int numPids, int lastStage, pid_t processGroup, char *commandLine) {
+    if (list->freeSlot == NO_SLOT) {
+        growBackgroundList(list);
+    }
+    int slot = list->freeSlot;
+    BackgroundProcess *process = &list->slots[slot];
+    list->freeSlot = process->next;
+
+    process->id = list->lastId++;
+    process->pid = pids[0];
+    process->processGroup = processGroup;
+    process->firstMember = NO_SLOT;
+    process->numMembers = 0;
+    // a last stage that did not start fails the job like it fails a pipeline in the foreground
+    process->lastPid = lastStage >= 0 ? pids[lastStage] : -1;
+    process->status = lastStage >= 0 ? 0 : 127;
+    process->remembered = 1;
+    for (int i = 0; i < numPids; i++) {
+        addBackgroundMember(list, slot, pids[i]);
+    }
+    setCommandLine(process, commandLine);
+    clock_gettime(CLOCK_MONOTONIC, &process->startTime);
+    process->state = BS_RUNNING;
+    process->next = NO_SLOT;
+    process->previous = list->tail;
+    if (list->head == NO_SLOT) {
+        list->head = slot;
     } else {
-        list->tail->next = process;
-    }
-    list->tail = process;
-}
-
-// remove a process from the list by its PID
-void removeBackgroundProcessByPID(BackgroundList *list, pid_t pid) {
-    BackgroundProcess *previous = NULL;
-    BackgroundProcess *current = list->head;
-    while (current != NULL) {
-        if (current->pid == pid) {
-            if (previous == NULL) {
-                list->head = current->next;
-            } else {
-                previous->next = current->next;
-            }
-            if (current == list->tail) {
-                list->tail = previous;
-            }
-            free(current);
-            return;
+        list->slots[list->tail].next = slot;
+    }
+    list->tail = slot;
+    insertBackgroundProcess(list, slot);
+    list->numProcesses++;
+}
+
+// add a new process whose status is collected by its owner, like a worker of a fan-out, so it is not remembered for wait
+void addBackgroundProcess(BackgroundList *list, pid_t pid, char *commandLine) {
+    addBackgroundJob(list, &pid, 1, 0, -1, commandLine);
+    list->slots[list->tail].remembered = 0;
+}
+
+// find the job of a process by its PID
+BackgroundProcess *findBackgroundProcessByPID(BackgroundList *list, pid_t pid) {
+    int member = findBackgroundMember(list, pid);
+    return member != NO_SLOT ? &list->slots[list->members[member].slot] : NULL;
+}
+
+// find a process by its ID
+BackgroundProcess *findBackgroundProcessByID(BackgroundList *list, int id) {
+    if (list->numBuckets == 0) {
+        return NULL;
+    }
+    int slot = list->idBuckets[hashBackgroundKey(id, list->numBuckets)];
+    while (slot != NO_SLOT && list->slots[slot].id != id) {
+        slot = list->slots[slot].nextById;
+    }
+    return slot != NO_SLOT ? &list->slots[slot] : NULL;
+}
+
+// unlink a slot from the list and the tables and free it
+void removeBackgroundProcess(BackgroundList *list, BackgroundProcess *process) {
+    int slot = process - list->slots;
+    if (process->previous == NO_SLOT) {
+        list->head = process->next;
+    } else {
+        list->slots[process->previous].next = process->next;
+    }
+    if (process->next == NO_SLOT) {
+        list->tail = process->previous;
+    } else {
+        list->slots[process->next].previous = process->previous;
+    }
+
+    for (int member = process->firstMember; member != NO_SLOT; member = list->members[member].nextInJob) {
+        removeBackgroundMember(list, member);
+    }
+    int *link = &list->idBuckets[hashBackgroundKey(process->id, list->numBuckets)];
+    while (*link != slot) {
+        link = &list->slots[*link].nextById;
+    }
+    *link = process->nextById;
+
+    process->next = list->freeSlot;
+    list->freeSlot = slot;
+    list->numProcesses--;
+}
+
+// remember the status of a finished job until it is waited for
+void addFinishedJob(BackgroundList *list, int id, int status) {
+    if (list->numFinished == FINISHED_JOBS) {
+        list->firstFinished = (list->firstFinished + 1) % FINISHED_JOBS;
+        list->numFinished--;
+    }
+    FinishedJob *job = &list->finishedJobs[(list->firstFinished + list->numFinished) % FINISHED_JOBS];
+    job->id = id;
+    job->status = status;
+    list->numFinished++;
+}
+
+// remove a finished process from its job by its PID, the job is removed with its last process
+void removeBackgroundProcessByPID(BackgroundList *list, pid_t pid, int status) {
+    int member = findBackgroundMember(list, pid);
+    if (member == NO_SLOT) {
+        return;
+    }
+    BackgroundProcess *process = &list->slots[list->members[member].slot];
+    if (pid == process->lastPid) {
+        process->status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    if (process->numMembers == 1) {
+        if (process->remembered) {
+            addFinishedJob(list, process->id, process->status);
         }
-        previous = current;
-        current = current->next;
+        removeBackgroundProcess(list, process);
+        return;
+    }
+    int *link = &process->firstMember;
+    while (*link != member) {
+        link = &list->members[*link].nextInJob;
     }
+    *link = list->members[member].nextInJob;
+    process->numMembers--;
+    removeBackgroundMember(list, member);
 }
 
 // remove a process from the list by its ID
 void removeBackgroundProcessByID(BackgroundList *list, int id) {
-    BackgroundProcess *previous = NULL;
-    BackgroundProcess *current = list->head;
-    while (current != NULL) {
-        if (current->id == id) {
-            if (previous == NULL) {
-                list->head = current->next;
-            } else {
-                previous->next = current->next;
-            }
-            if (current == list->tail) {
-                list->tail = previous;
-            }
-            free(current);
-            return;
-        }
-        previous = current;
-        current = current->next;
+    BackgroundProcess *process = findBackgroundProcessByID(list, id);
+    if (process != NULL) {
+        removeBackgroundProcess(list, process);
     }
 }
 
 // get the PID of a process by its ID
 pid_t getBackgroundProcessPID(BackgroundList *list, int id) {
-    BackgroundProcess *current = list->head;
-    while (current != NULL) {
-        if (current->id == id) {
-            return current->pid;
+    BackgroundProcess *process = findBackgroundProcessByID(list, id);
+    return process != NULL ? process->pid : -1;
+}
+
+// take a finished job from the ones that were not waited for, any job if the id is -1
+int takeFinishedJob(BackgroundList *list, int id, FinishedJob *job) {
+    for (int i = 0; i < list->numFinished; i++) {
+        FinishedJob *finished = &list->finishedJobs[(list->firstFinished + i) % FINISHED_JOBS];
+        if (id != -1 && finished->id != id) {
+            continue;
+        }
+        *job = *finished;
+        // close the gap by moving the newer jobs one place back
+        for (int j = i + 1; j < list->numFinished; j++) {
+            list->finishedJobs[(list->firstFinished + j - 1) % FINISHED_JOBS] = list->finishedJobs[(list->firstFinished + j) % FINISHED_JOBS];
         }
-        current = current->next;
+        list->numFinished--;
+        return 1;
     }
-    return -1;
+    return 0;
 }
 
-// print the list in reverse order
-void printBackgroundList(BackgroundProcess *current) {
-    if (current == NULL) {
-        return;
+// print the list from the newest process to the oldest
+void printBackgroundList(BackgroundList *list, int longFormat) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (int slot = list->tail; slot != NO_SLOT; slot = list->slots[slot].previous) {
+        BackgroundProcess *process = &list->slots[slot];
+        if (!longFormat) {
+            printf("Process running with index %d\n", process->id);
+            continue;
+        }
+        double elapsed = (now.tv_sec - process->startTime.tv_sec) + (now.tv_nsec - process->startTime.tv_nsec) / 1e9;
+        printf("Process running with index %d\t%d\t%s\t%.1fs\t%s\n", process->id, process->pid,
+            process->state == BS_RUNNING ? "Running" : "Signalled", elapsed, process->commandLine);
     }
-    printBackgroundList(current->next);
-    printf("Process running with index %d\n", current->id);
 }
 
 // check if the list is empty
 int isEmptyBackgroundList(BackgroundList *list) {
-    return list->head == NULL;
+    return list->head == NO_SLOT;
 }
 
 // free the list
 void freeBackgroundList(BackgroundList *list) {
-    BackgroundProcess *current = list->head;
-    while (current != NULL) {
-        BackgroundProcess *next = current->next;
-        free(current);
-        current = next;
+    for (int slot = 0; slot < list->numSlots; slot++) {
+        free(list->slots[slot].commandLine);
     }
+    free(list->slots);
+    free(list->idBuckets);
+    free(list->members);
+    free(list->pidBuckets);
     free(list);
 }
\ No newline at end of file
@@ -2,27 +2,94 @@
 #define LIST_H
 
 #include <unistd.h>
+#include <time.h>
 
-// structure for a node in the list
+// number of finished jobs that are remembered until they are waited for
+#define FINISHED_JOBS 64
+
+// states of a background process
+typedef enum BackgroundState {
+    BS_RUNNING,
+    BS_SIGNALLED
+} BackgroundState;
+
+// structure for a slot in the job table, slots are linked by their index
 typedef struct BackgroundProcess {
-    pid_t id;
-    int pid;
-    struct BackgroundProcess *next;
+    int id;
+    // the first process of the job
+    pid_t pid;
+    // the process group of the job, -1 if its processes share the group of the shell
+    pid_t processGroup;
+    // the buffer of the command line stays with the slot and is reused by its next jobs
+    char *commandLine;
+    size_t commandLineCapacity;
+    struct timespec startTime;
+    BackgroundState state;
+    // the neighbours in starting order, or the next free slot
+    int next;
+    int previous;
+    // the next slot in the same bucket of the id table
+    int nextById;
+    // the processes of the job that did not finish yet
+    int firstMember;
+    int numMembers;
+    // the exit status of the job is the one of the last stage of its pipeline
+    pid_t lastPid;
+    int status;
+    // whether the status is remembered for wait when the job finishes
+    int remembered;
 } BackgroundProcess;
 
-// structure for the list
+// structure for a job that finished and was not waited for yet
+typedef struct FinishedJob {
+    int id;
+    int status;
+} FinishedJob;
+
+// structure for a process of a job, members are linked by their index
+typedef struct BackgroundMember {
+    pid_t pid;
+    int slot;
+    // the next member in the same bucket of the pid table, or the next free member
+    int nextByPid;
+    // the next member of the same job
+    int nextInJob;
+} BackgroundMember;
+
+// structure for the job table
 typedef struct BackgroundList {
-    BackgroundProcess *head;
-    BackgroundProcess *tail;
+    BackgroundProcess *slots;
+    int numSlots;
+    int freeSlot;
+    int head;
+    int tail;
     int lastId;
+    // table to find a slot by its id
+    int *idBuckets;
+    int numBuckets;
+    int numProcesses;
+    // the processes of the jobs and the table to find them by their pid
+    BackgroundMember *members;
+    int numMemberSlots;
+    int freeMember;
+    int *pidBuckets;
+    int numPidBuckets;
+    // the finished jobs from the oldest to the newest, the oldest is forgotten when it is full
+    FinishedJob finishedJobs[FINISHED_JOBS];
+    int firstFinished;
+    int numFinished;
 } BackgroundList;
 
 BackgroundList *createBackgroundList();
-void addBackgroundProcess(BackgroundList *list, pid_t pid);
-void removeBackgroundProcessByPID(BackgroundList *list, pid_t pid);
+void addBackgroundProcess(BackgroundList *list, pid_t pid, char *commandLine);
+void addBackgroundJob(BackgroundList *list, pid_t *pids, int numPids, int lastStage, pid_t processGroup, char *commandLine);
+BackgroundProcess *findBackgroundProcessByPID(BackgroundList *list, pid_t pid);
+BackgroundProcess *findBackgroundProcessByID(BackgroundList *list, int id);
+void removeBackgroundProcessByPID(BackgroundList *list, pid_t pid, int status);
 void removeBackgroundProcessByID(BackgroundList *list, int id);
-pid_t getBackgroundProcessPID(BackgroundList *list, pid_t id);
-void printBackgroundList(BackgroundProcess *current);
+pid_t getBackgroundProcessPID(BackgroundList *list, int id);
+int takeFinishedJob(BackgroundList *list, int id, FinishedJob *job);
+void printBackgroundList(BackgroundList *list, int longFormat);
 int isEmptyBackgroundList(BackgroundList *list);
 void freeBackgroundList(BackgroundList *list);
 
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "loop.h"
+#include "usage.h"
+#include "utility.h"
+
+extern int *status;
+extern ActiveOperator activeOperator;
+extern ActiveOperator futureOperator;
+
+// the variables of the running for loops, the innermost last
+LoopVariable *loopVariables = NULL;
+int numLoopVariables = 0;
+int loopVariablesCapacity = 0;
+
+// find the value of a variable, an inner loop hides the variables of the outer loops
+char *findLoopVariable(char *name, size_t length) {
+    for (int i = numLoopVariables - 1; i >= 0; i--) {
+        if (strncmp(loopVariables[i].name, name, length) == 0 && loopVariables[i].name[length] == '\0') {
+            return loopVariables[i].value;
+        }
+    }
+    return NULL;
+}
+
+// read the variable a $ starts, as $name or ${name}, returns its value or NULL if no loop has it
+char *readVariable(char *dollar, size_t *used) {
+    char *name = dollar + 1;
+    int braces = *name == '{';
+    name += braces;
+    if (!isalpha((unsigned char) name[0]) && name[0] != '_') {
+        return NULL;
+    }
+    size_t length = 0;
+    while (isalnum((unsigned char) name[length]) || name[length] == '_') {
+        length++;
+    }
+    if (braces && name[length] != '}') {
+        return NULL;
+    }
+    *used = 1 + length + braces * 2;
+    return findLoopVariable(name, length);
+}
+
+// substitute the variables of the loops in a word, returns the length of the result; out can be NULL to only measure it
+size_t substituteVariables(char *word, char *out, int *substituted) {
+    size_t length = 0;
+    char *p = word;
+    while (*p != '\0') {
+        size_t used = 0;
+        char *value = *p == '$' ? readVariable(p, &used) : NULL;
+        if (value == NULL) {
+            // anything that is not a variable of a loop is kept as it is
+            if (out != NULL) {
+                out[length] = *p;
+            }
+            length++;
+            p++;
+            continue;
+        }
+        size_t valueLength = strlen(value);
+        if (out != NULL) {
+            memcpy(out + length, value, valueLength);
+        }
+        length += valueLength;
+        p += used;
+        *substituted = 1;
+    }
+    return length;
+}
+
+// expand a word, the word itself is returned if it uses no variable; a value stays one word
+char *expandWord(char *word, Arena *arena) {
+    if (strchr(word, '$') == NULL) {
+        return word;
+    }
+    int substituted = 0;
+    size_t length = substituteVariables(word, NULL, &substituted);
+    if (!substituted) {
+        return word;
+    }
+    char *expanded = arenaAlloc(arena, length + 1);
+    substituteVariables(word, expanded, &substituted);
+    expanded[length] = '\0';
+    return expanded;
+}
+
+// expand the arguments of a command
+Command *expandCommand(Command *command, Arena *arena) {
+    Args *args = command->commandArgs;
+    Command *expanded = arenaAlloc(arena, sizeof(Command));
+    *expanded = *command;
+    expanded->commandArgs = arenaAlloc(arena, sizeof(Args));
+    expanded->commandArgs->args = arenaAlloc(arena, (args->numArgs + 1) * sizeof(char *));
+    expanded->commandArgs->numArgs = args->numArgs;
+    expanded->commandArgs->capacity = args->numArgs + 1;
+    for (int i = 0; i < args->numArgs; i++) {
+        expanded->commandArgs->args[i] = expandWord(args->args[i], arena);
+    }
+    expanded->commandArgs->args[args->numArgs] = NULL;
+    // a name that comes from a variable can be one of the utilities
+    if (command->commandName != NULL && expanded->commandArgs->args[0] != command->commandName) {
+        expanded->commandName = expanded->commandArgs->args[0];
+        expanded->builtInCommand = findUtility(expanded->commandName);
+    }
+    return expanded;
+}
+
+// expand the words of a file list
+FileList *expandFileList(FileList *fileList, Arena *arena) {
+    FileList *expanded = arenaAlloc(arena, sizeof(FileList));
+    expanded->files = arenaAlloc(arena, (fileList->numFiles + 1) * sizeof(char *));
+    expanded->numFiles = fileList->numFiles;
+    expanded->capacity = fileList->numFiles + 1;
+    for (int i = 0; i < fileList->numFiles; i++) {
+        expanded->files[i] = expandWord(fileList->files[i], arena);
+    }
+    expanded->files[fileList->numFiles] = NULL;
+    return expanded;
+}
+
+// expand the variables of the loops in a chain, the parsed chain is kept and the copy lives in the arena
+Chain *expandChain(Chain *chain, Arena *arena) {
+    Chain *expanded = arenaAlloc(arena, sizeof(Chain));
+    *expanded = *chain;
+    if (chain->BuiltInCommand != NULL) {
+        expanded->BuiltInCommand = expandCommand(chain->BuiltInCommand, arena);
+    }
+    if (chain->loop != NULL) {
+        // the chains of an inner loop are expanded when they run, only its words are expanded now
+        expanded->loop = arenaAlloc(arena, sizeof(Loop));
+        *expanded->loop = *chain->loop;
+        if (chain->loop->words != NULL) {
+            expanded->loop->words = expandFileList(chain->loop->words, arena);
+        }
+    }
+    if (chain->pipelineRedirections != NULL) {
+        Pipeline *pipeline = chain->pipelineRedirections->pipeline;
+        Redirections *redirections = chain->pipelineRedirections->redirections;
+        PipelineRedirections *pipelineRedirections = arenaAlloc(arena, sizeof(PipelineRedirections));
+        pipelineRedirections->pipeline = arenaAlloc(arena, sizeof(Pipeline));
+        pipelineRedirections->pipeline->commands = arenaAlloc(arena, pipeline->numCommands * sizeof(Command *));
+        pipelineRedirections->pipeline->numCommands = pipeline->numCommands;
+        pipelineRedirections->pipeline->capacity = pipeline->numCommands;
+        for (int i = 0; i < pipeline->numCommands; i++) {
+            pipelineRedirections->pipeline->commands[i] = expandCommand(pipeline->commands[i], arena);
+        }
+        pipelineRedirections->redirections = arenaAlloc(arena, sizeof(Redirections));
+        pipelineRedirections->redirections->inputFiles = expandFileList(redirections->inputFiles, arena);
+        pipelineRedirections->redirections->outputFiles = expandFileList(redirections->outputFiles, arena);
+        pipelineRedirections->redirections->errorFiles = expandFileList(redirections->errorFiles, arena);
+        expanded->pipelineRedirections = pipelineRedirections;
+    }
+    return expanded;
+}
+
+// add the variable of a for loop
+void pushLoopVariable(char *name) {
+    if (numLoopVariables == loopVariablesCapacity) {
+        loopVariablesCapacity = loopVariablesCapacity == 0 ? 4 : loopVariablesCapacity * 2;
+        loopVariables = realloc(loopVariables, loopVariablesCapacity * sizeof(LoopVariable));
+    }
+    loopVariables[numLoopVariables].name = name;
+    loopVariables[numLoopVariables].value = "";
+    numLoopVariables++;
+}
+
+// read a range {first..last} of integers
+int parseRange(char *word, long long *first, long long *last) {
+    if (word[0] != '{') {
+        return 0;
+    }
+    char *end;
+    *first = strtoll(word + 1, &end, 10);
+    if (end == word + 1 || strncmp(end, "..", 2) != 0) {
+        return 0;
+    }
+    char *second = end + 2;
+    *last = strtoll(second, &end, 10);
+    return end != second && strcmp(end, "}") == 0;
+}
+
+// run the chains of a list with the operators between them
+void runLoopChains(ChainList *chainList, Arena *arena) {
+    for (int i = 0; i < chainList->numChains; i++) {
+        activeOperator = chainList->operators[i];
+        futureOperator = chainList->chains[i]->background ? AO_AND_STATEMENT : AO_NONE;
+        if (numLoopVariables == 0) {
+            runChain(chainList->chains[i]);
+            continue;
+        }
+        runChain(expandChain(chainList->chains[i], arena));
+        // the copy is only needed while its chain runs
+        resetArena(arena);
+    }
+}
+
+// run the body of a for loop with a value of its variable
+void runForIteration(Loop *loop, char *value, Arena *arena) {
+    loopVariables[numLoopVariables - 1].value = value;
+    runLoopChains(loop->body, arena);
+}
+
+// run a loop, its parsed chains are run again for every iteration; the status is that of the last
+// chain of the body, or 0 if the body never ran
+void runLoop(Loop *loop) {
+    ActiveOperator previousActive = activeOperator;
+    ActiveOperator previousFuture = futureOperator;
+    Arena *arena = createArena();
+    int loopStatus = 0;
+    if (loop->type == LT_WHILE) {
+        while (1) {
+            runLoopChains(loop->condition, arena);
+            if (*status != 0) {
+                break;
+            }
+            runLoopChains(loop->body, arena);
+            loopStatus = *status;
+        }
+    } else {
+        pushLoopVariable(loop->variable);
+        char number[32];
+        for (int i = 0; i < loop->words->numFiles; i++) {
+            long long first, last;
+            if (!parseRange(loop->words->files[i], &first, &last)) {
+                runForIteration(loop, loop->words->files[i], arena);
+                loopStatus = *status;
+                continue;
+            }
+            // a range counts up or down without making all of its words
+            for (long long n = first; ; n += first <= last ? 1 : -1) {
+                snprintf(number, sizeof(number), "%lld", n);
+                runForIteration(loop, number, arena);
+                loopStatus = *status;
+                if (n == last) {
+                    break;
+                }
+            }
+        }
+        numLoopVariables--;
+    }
+    freeArena(arena);
+    *status = loopStatus;
+    activeOperator = previousActive;
+    futureOperator = previousFuture;
+}
\ No newline at end of file
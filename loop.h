@@ -0,0 +1,16 @@
+#ifndef LOOP_H
+#define LOOP_H
+
+#include "structs.h"
+#include "arena.h"
+
+// structure for the variable of a running for loop
+typedef struct LoopVariable {
+    char *name;
+    char *value;
+} LoopVariable;
+
+Chain *expandChain(Chain *chain, Arena *arena);
+void runLoop(Loop *loop);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,316 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/wait.h>
+
+#include "parallel.h"
+#include "usage.h"
+#include "list.h"
+#include "reap.h"
+#include "fanout.h"
+
+extern int *status;
+extern ActiveOperator activeOperator;
+extern ActiveOperator futureOperator;
+extern BackgroundList *backgroundList;
+extern void printColor(char *color, char *msg);
+
+// check if a built-in command changes the shell, so it cannot run in a worker
+int isShellChangingBuiltIn(Command *command) {
+    switch (command->builtInCommand) {
+        case BIC_EXIT:
+        case BIC_CD:
+        case BIC_PUSHD:
+        case BIC_POPD:
+            return 1;
+        case BIC_HASH:
+        case BIC_PIPESIZE:
+            return command->commandArgs->numArgs > 0;
+        default:
+            return 0;
+    }
+}
+
+// add the files a chain reads and writes to the set of its unit, arguments may be files it uses too
+void addChainFiles(FileSet *set, Chain *chain) {
+    if (chain->pipelineRedirections == NULL) {
+        return;
+    }
+    Redirections *redirections = chain->pipelineRedirections->redirections;
+    for (int i = 0; i < redirections->outputFiles->numFiles; i++) {
+        addPathToSet(set, redirections->outputFiles->files[i], FR_OUTPUT);
+    }
+    for (int i = 0; i < redirections->errorFiles->numFiles; i++) {
+        addPathToSet(set, redirections->errorFiles->files[i], FR_OUTPUT);
+    }
+    for (int i = 0; i < redirections->inputFiles->numFiles; i++) {
+        addPathToSet(set, redirections->inputFiles->files[i], FR_INPUT);
+    }
+    Pipeline *pipeline = chain->pipelineRedirections->pipeline;
+    for (int i = 0; i < pipeline->numCommands; i++) {
+        Args *args = pipeline->commands[i]->commandArgs;
+        for (int j = 0; j < args->numArgs; j++) {
+            addPathToSet(set, args->args[j], FR_INPUT);
+        }
+    }
+}
+
+// count the files a chain may use
+int countChainFiles(Chain *chain) {
+    if (chain->pipelineRedirections == NULL) {
+        return 0;
+    }
+    Redirections *redirections = chain->pipelineRedirections->redirections;
+    int numFiles = redirections->inputFiles->numFiles + redirections->outputFiles->numFiles + redirections->errorFiles->numFiles;
+    Pipeline *pipeline = chain->pipelineRedirections->pipeline;
+    for (int i = 0; i < pipeline->numCommands; i++) {
+        numFiles += pipeline->commands[i]->commandArgs->numArgs;
+    }
+    return numFiles;
+}
+
+// collect the files of the chains of a unit, they are found by device and inode like the files of a pipeline
+void collectUnitFiles(ChainList *chainList, ParallelUnit *unit) {
+    int numFiles = 0;
+    for (int i = unit->first; i < unit->first + unit->numChains; i++) {
+        numFiles += countChainFiles(chainList->chains[i]);
+    }
+    initFileSet(&unit->files, numFiles);
+    for (int i = unit->first; i < unit->first + unit->numChains; i++) {
+        addChainFiles(&unit->files, chainList->chains[i]);
+    }
+}
+
+// split the chains into units, a unit continues as long as chains are joined by && or ||
+ParallelUnit *createParallelUnits(ChainList *chainList, int *numUnits) {
+    ParallelUnit *units = malloc(chainList->numChains * sizeof(ParallelUnit));
+    *numUnits = 0;
+    for (int i = 0; i < chainList->numChains; i++) {
+        ActiveOperator operator = chainList->operators[i];
+        if (i == 0 || (operator != AO_AND_OPERATOR && operator != AO_OR_OPERATOR)) {
+            ParallelUnit *unit = &units[(*numUnits)++];
+            unit->first = i;
+            unit->numChains = 0;
+            unit->barrier = 0;
+            unit->state = PU_WAITING;
+            unit->pid = -1;
+            unit->output = -1;
+            unit->error = -1;
+            unit->status = 0;
+        }
+        ParallelUnit *unit = &units[*numUnits - 1];
+        unit->numChains++;
+        Chain *chain = chainList->chains[i];
+        if (chain->BuiltInCommand != NULL && isShellChangingBuiltIn(chain->BuiltInCommand)) {
+            unit->barrier = 1;
+        }
+        // a loop can change the shell and use any file
+        if (chain->loop != NULL) {
+            unit->barrier = 1;
+        }
+    }
+    for (int i = 0; i < *numUnits; i++) {
+        collectUnitFiles(chainList, &units[i]);
+    }
+    return units;
+}
+
+// check if two units use a file that at least one of them writes
+int unitsConflict(ParallelUnit *first, ParallelUnit *second) {
+    return hasSharedFile(&first->files, &second->files, FR_OUTPUT);
+}
+
+// check if a unit can start, every earlier unit it conflicts with has to be finished
+int canStartUnit(ParallelUnit *units, int index) {
+    for (int i = 0; i < index; i++) {
+        if (units[i].state >= PU_FINISHED) {
+            continue;
+        }
+        if (units[index].barrier || units[i].barrier || unitsConflict(&units[i], &units[index])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// run the chains of a unit with the operators between them
+void runUnitChains(ChainList *chainList, ParallelUnit *unit) {
+    for (int i = unit->first; i < unit->first + unit->numChains; i++) {
+        activeOperator = i == unit->first ? AO_NONE : chainList->operators[i];
+        futureOperator = chainList->chains[i]->background ? AO_AND_STATEMENT : AO_NONE;
+        runChain(chainList->chains[i]);
+    }
+}
+
+// start a unit in a worker, its output is captured so it can be written in order
+void startUnit(ChainList *chainList, ParallelUnit *unit) {
+    unit->output = memfd_create("parallel-output", MFD_CLOEXEC);
+    unit->error = memfd_create("parallel-error", MFD_CLOEXEC);
+    if (unit->output < 0 || unit->error < 0) {
+        printColor("\033[0;31m", "Error: the output of a parallel block could not be captured!\n");
+        exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        printColor("\033[0;31m", "Error: fork() could not create a child process!\n");
+        exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
+    } else if (pid == 0) {
+        // the worker waits for its own commands
+        finalizeChildReaper();
+
+        // reset the int signal handler for the worker
+        struct sigaction sigint;
+        sigemptyset(&sigint.sa_mask);
+        sigint.sa_flags = SA_RESTART;
+        sigint.sa_handler = SIG_DFL;
+        sigaction(SIGINT, &sigint, NULL);
+
+        // units run at the same time, so none of them can read the shell's input
+        int devNull = open("/dev/null", O_RDONLY);
+        dup2(devNull, STDIN_FILENO);
+        close(devNull);
+        dup2(unit->output, STDOUT_FILENO);
+        dup2(unit->error, STDERR_FILENO);
+
+        runUnitChains(chainList, unit);
+        exit(*status);
+    }
+    unit->pid = pid;
+    unit->state = PU_RUNNING;
+}
+
+// copy captured output to the shell's output
+void copyCapturedOutput(int captured, int fd) {
+    off_t offset = 0;
+    off_t size = lseek(captured, 0, SEEK_END);
+    while (offset < size) {
+        ssize_t len = sendfile(fd, captured, &offset, size - offset);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            // sendfile cannot write to every descriptor, copy through a buffer
+            char buffer[65536];
+            while ((len = pread(captured, buffer, sizeof(buffer), offset)) > 0) {
+                if (write(fd, buffer, len) != len) {
+                    break;
+                }
+                offset += len;
+            }
+            break;
+        }
+    }
+    close(captured);
+}
+
+// wait for a worker to finish, returns the number of units that finished
+int waitForUnit(ParallelUnit *units, int numUnits) {
+    while (1) {
+        int workerStatus;
+        pid_t pid = waitpid(-1, &workerStatus, 0);
+        if (pid < 0 && errno == EINTR) {
+            continue;
+        }
+        if (pid < 0) {
+            // the workers cannot be waited for, so none of the running units has a status
+            printColor("\033[0;31m", "Error: the workers of a parallel block were lost!\n");
+            int numLost = 0;
+            for (int i = 0; i < numUnits; i++) {
+                if (units[i].state == PU_RUNNING) {
+                    units[i].state = PU_FINISHED;
+                    units[i].status = 127;
+                    numLost++;
+                }
+            }
+            return numLost;
+        }
+        for (int i = 0; i < numUnits; i++) {
+            if (units[i].pid == pid && units[i].state == PU_RUNNING) {
+                units[i].state = PU_FINISHED;
+                // a worker killed by a signal fails like a job, with 128 and the signal
+                units[i].status = WIFSIGNALED(workerStatus) ? 128 + WTERMSIG(workerStatus) : WEXITSTATUS(workerStatus);
+                return 1;
+            }
+        }
+        // a background job finished while the block ran
+        removeBackgroundProcessByPID(backgroundList, pid, workerStatus);
+        collectFanoutWorker(pid, workerStatus);
+    }
+}
+
+// run the chains of a parallel block, chains that share no written files run at the same time
+void runParallel(ChainList *chainList) {
+    // for && don't run if the previous chain failed
+    if (activeOperator == AO_AND_OPERATOR && status != NULL && *status != 0) {
+        return;
+    }
+    // for || don't run if the previous chain succeeded
+    if (activeOperator == AO_OR_OPERATOR && status != NULL && *status == 0) {
+        return;
+    }
+    if (chainList->numChains == 0) {
+        return;
+    }
+
+    int limit = chainList->limit > 0 ? chainList->limit : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (limit < 1) {
+        limit = 1;
+    }
+    int numUnits;
+    ParallelUnit *units = createParallelUnits(chainList, &numUnits);
+    int numRunning = 0;
+    int numFlushed = 0;
+    int lastStatus = *status;
+
+    pauseChildReaper(1);
+    while (numFlushed < numUnits) {
+        // start every unit that may run now
+        for (int i = numFlushed; i < numUnits && numRunning < limit; i++) {
+            if (units[i].state != PU_WAITING || !canStartUnit(units, i)) {
+                continue;
+            }
+            if (units[i].barrier) {
+                // everything before it has been written, so it runs in the shell like a normal chain
+                if (i != numFlushed) {
+                    continue;
+                }
+                runUnitChains(chainList, &units[i]);
+                units[i].status = *status;
+                units[i].state = PU_FLUSHED;
+                lastStatus = units[i].status;
+                numFlushed++;
+                continue;
+            }
+            startUnit(chainList, &units[i]);
+            numRunning++;
+        }
+
+        // write the output of finished units in the order of the block
+        while (numFlushed < numUnits && units[numFlushed].state == PU_FINISHED) {
+            copyCapturedOutput(units[numFlushed].output, STDOUT_FILENO);
+            copyCapturedOutput(units[numFlushed].error, STDERR_FILENO);
+            units[numFlushed].state = PU_FLUSHED;
+            lastStatus = units[numFlushed].status;
+            numFlushed++;
+        }
+
+        // everything that could start has started, so wait for a worker
+        if (numRunning > 0) {
+            numRunning -= waitForUnit(units, numUnits);
+        }
+    }
+    pauseChildReaper(0);
+
+    *status = lastStatus;
+    for (int i = 0; i < numUnits; i++) {
+        freeFileSet(&units[i].files);
+    }
+    free(units);
+}
\ No newline at end of file
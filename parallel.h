@@ -0,0 +1,36 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <unistd.h>
+
+#include "structs.h"
+#include "fileset.h"
+
+// states of a unit of a parallel block
+typedef enum ParallelUnitState {
+    PU_WAITING,
+    PU_RUNNING,
+    PU_FINISHED,
+    PU_FLUSHED
+} ParallelUnitState;
+
+// structure for chains of a parallel block that depend on each other through && and ||
+typedef struct ParallelUnit {
+    int first;
+    int numChains;
+    // whether the unit changes the shell, so it runs in the shell on its own
+    int barrier;
+    ParallelUnitState state;
+    pid_t pid;
+    // the captured stdout and stderr of the unit
+    int output;
+    int error;
+    int status;
+    // the files the chains of the unit read or write, by their device and inode
+    FileSet files;
+} ParallelUnit;
+
+void copyCapturedOutput(int captured, int fd);
+void runParallel(ChainList *chainList);
+
+#endif
\ No newline at end of file
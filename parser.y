@@ -10,8 +10,21 @@
     #include "stack.h"
     #endif
     #include "list.h"
+    #include "reap.h"
+    #include "pathcache.h"
     #include "structs.h"
+    #include "arena.h"
     #include "usage.h"
+    #include "launch.h"
+    #include "pump.h"
+    #include "account.h"
+    #include "pipesize.h"
+    #include "fanout.h"
+    #include "parallel.h"
+    #include "scriptcache.h"
+    #include "profile.h"
+    #include "workdir.h"
+    #include "lexinput.h"
 
     void yyerror(char *msg);    /* forward declaration */
     extern int yylex(void);
@@ -21,6 +34,8 @@
     extern void printPrompt();
     extern void freeError();
     extern void sigIntHandler(int signo);
+    void dispatchChain(Chain *chain);
+    void dispatchParallel(ChainList *chainList);
 
     #if EXT_PROMPT
     // stack to remember the previous directories
@@ -28,13 +43,11 @@
     int scriptInput = 0;
     #endif
     BackgroundList *backgroundList;
+    // cache of the resolved command paths
+    PathCache *pathCache;
 
-    // variables to remember the allocated memory to free in case of an error
-    Chain *lastChain = NULL;
-    Pipeline *lastPipeline = NULL;
-    Redirections *lastRedirections = NULL;
-    Command *lastCommand = NULL;
-    Args *lastArgs = NULL;
+    // memory of the parse tree and the strings of the current input line
+    Arena *parseArena = NULL;
     void freeError();
 
     // remember the previous operator to be used
@@ -44,10 +57,10 @@
     // remember the status of the last command
     int *status = NULL;
     // remember the current path
-    char *currentPath = NULL;
+    WorkingDirectory *workingDirectory = NULL;
 %}
 
-%token EXIT_KEYWORD AND_OP OR_OP SEMICOLON NEWLINE AND_STATEMENT OR_STATEMENT INPUT_REDIRECT OUTPUT_REDIRECT ERROR_REDIRECT STATUS_KEYWORD CD_KEYWORD PUSHD_KEYWORD POPD_KEYWORD KILL_KEYWORD JOBS_KEYWORD
+%token EXIT_KEYWORD AND_OP OR_OP SEMICOLON NEWLINE AND_STATEMENT OR_STATEMENT INPUT_REDIRECT OUTPUT_REDIRECT ERROR_REDIRECT STATUS_KEYWORD CD_KEYWORD PUSHD_KEYWORD POPD_KEYWORD KILL_KEYWORD JOBS_KEYWORD HASH_KEYWORD TIME_KEYWORD TIMEOUT_KEYWORD PIPESIZE_KEYWORD FANOUT_KEYWORD WAIT_KEYWORD PARALLEL_KEYWORD LBRACE RBRACE FOR_KEYWORD WHILE_KEYWORD DO_KEYWORD DONE_KEYWORD
 
 %token <stringValue> STRING
 %token <stringValue> WORD
@@ -60,9 +73,19 @@
 %type <stringValue> inputRedirect
 %type <stringValue> outputRedirect
 %type <stringValue> errorRedirect
+%type <stringValue> word
+%type <stringValue> keyword
 %type <chain> chain
+%type <chainList> chainSequence
+%type <chainList> blockBody
+%type <chainList> parallelBlock
+%type <loop> loop
+%type <fileList> loopWords
 
 %union {
+    ChainList *chainList;
+    Loop *loop;
+    FileList *fileList;
     Chain *chain;
     BuiltInCommand builtInCommand;
     Pipeline *pipeline;
@@ -74,21 +97,57 @@
 
 %%
 
-input                   : inputline NEWLINE { printPrompt(); } input
-                        | error NEWLINE { freeError(); yyerrok; } input
+input                   : input inputline NEWLINE { resetArena(parseArena); printPrompt(); }    // left recursive so long scripts do not grow the parser stack
+                        | input error NEWLINE { freeError(); yyerrok; }
                         | /* empty */
 
-inputline               : chain AND_STATEMENT { futureOperator = AO_AND_STATEMENT; runChain($1); activeOperator = AO_AND_STATEMENT; lastChain = NULL; } inputline
-                        | chain AND_OP { futureOperator = AO_AND_OPERATOR; runChain($1); activeOperator = AO_AND_OPERATOR; lastChain = NULL; } inputline
-                        | chain OR_OP { futureOperator = AO_OR_OPERATOR; runChain($1); activeOperator = AO_OR_OPERATOR; lastChain = NULL; } inputline
-                        | chain SEMICOLON { futureOperator = AO_SEMICOLON; runChain($1); activeOperator = AO_SEMICOLON; lastChain = NULL; } inputline  // allow use of semicolon as a command separator
-                        | chain { futureOperator = AO_NONE; runChain($1); activeOperator = AO_NONE; lastChain = NULL; }
+inputline               : chain AND_STATEMENT { futureOperator = AO_AND_STATEMENT; dispatchChain($1); activeOperator = AO_AND_STATEMENT; } inputline
+                        | chain AND_OP { futureOperator = AO_AND_OPERATOR; dispatchChain($1); activeOperator = AO_AND_OPERATOR; } inputline
+                        | chain OR_OP { futureOperator = AO_OR_OPERATOR; dispatchChain($1); activeOperator = AO_OR_OPERATOR; } inputline
+                        | chain SEMICOLON { futureOperator = AO_SEMICOLON; dispatchChain($1); activeOperator = AO_SEMICOLON; } inputline  // allow use of semicolon as a command separator
+                        | chain { futureOperator = AO_NONE; dispatchChain($1); activeOperator = AO_NONE; }
+                        | parallelBlock SEMICOLON { futureOperator = AO_SEMICOLON; dispatchParallel($1); activeOperator = AO_SEMICOLON; } inputline
+                        | parallelBlock { futureOperator = AO_NONE; dispatchParallel($1); activeOperator = AO_NONE; }
                         | SEMICOLON { futureOperator = AO_SEMICOLON; activeOperator = AO_SEMICOLON; } inputline    // inappropriate semicolon usage is not considered an error
                         | /* empty */ { futureOperator = AO_NONE; activeOperator = AO_NONE; }
                         ;
 
-chain                   : pipeline redirections { $$ = createChain(createPipelineRedirections($1, $2), NULL); }
-                        | builtin options { $$ = createChain(NULL, createBuiltInCommand($1, $2)); }
+parallelBlock           : PARALLEL_KEYWORD LBRACE blockBody RBRACE { $$ = $3; }
+                        | PARALLEL_KEYWORD WORD LBRACE blockBody RBRACE { $$ = $4; $$->limit = atoi($2); if ($$->limit < 1) { goto yyerrlab; } }
+                        ;
+
+// the chains of a parallel block or of the body of a loop
+blockBody               : /* empty */ { $$ = createChainList(); }
+                        | blockBody NEWLINE { $$ = $1; }
+                        | blockBody SEMICOLON { $$ = $1; }
+                        | blockBody chainSequence NEWLINE { $$ = appendChainList($1, $2); }     // the closing brace or done has to follow a separator
+                        | blockBody chainSequence SEMICOLON { $$ = appendChainList($1, $2); }
+                        | blockBody chainSequence AND_STATEMENT { $2->chains[$2->numChains - 1]->background = 1; $$ = appendChainList($1, $2); }    // & ends a chain like a separator
+                        ;
+
+// the body of a loop is parsed once, the loop runs it as often as needed
+loop                    : FOR_KEYWORD WORD WORD loopWords loopSeparator DO_KEYWORD blockBody DONE_KEYWORD { if (strcmp($3, "in") != 0) { goto yyerrlab; } $$ = createForLoop($2, $4, $7); }
+                        | WHILE_KEYWORD chainSequence loopSeparator DO_KEYWORD blockBody DONE_KEYWORD { $$ = createWhileLoop($2, $5); }
+                        ;
+
+loopWords               : loopWords word { $$ = addFile($1, $2); }    // keywords are items like in arguments
+                        | loopWords STRING { $$ = addFile($1, $2); }
+                        | /* empty */ { $$ = createFileList(); }
+                        ;
+
+loopSeparator           : SEMICOLON
+                        | NEWLINE
+                        ;
+
+chainSequence           : chain { $$ = addChainToList(createChainList(), $1, AO_NEWLINE); }
+                        | chainSequence AND_OP chain { $$ = addChainToList($1, $3, AO_AND_OPERATOR); }
+                        | chainSequence OR_OP chain { $$ = addChainToList($1, $3, AO_OR_OPERATOR); }
+                        ;
+
+chain                   : pipeline redirections { $$ = createPipelineChain($1, $2); }
+                        | TIME_KEYWORD pipeline redirections { $$ = createPipelineChain($2, $3); $$->timed = 1; }
+                        | TIMEOUT_KEYWORD pipeline redirections { $$ = createTimeoutChain($2, $3); }
+                        | loop { $$ = createLoopChain($1); }
                         ;
 
 redirections            : redirections inputRedirect { $$ = addRedirection($1, $2, R_INPUT); if ($$ == NULL) { goto yyerrlab; } }
@@ -97,13 +156,13 @@ redirections            : redirections inputRedirect { $$ = addRedirection($1, $
                         | /* empty */ { $$ = createRedirections(); }
                         ;
 
-inputRedirect           : INPUT_REDIRECT WORD { $$ = $2; }
+inputRedirect           : INPUT_REDIRECT word { $$ = $2; }
                         ;
 
-outputRedirect          : OUTPUT_REDIRECT WORD { $$ = $2; }
+outputRedirect          : OUTPUT_REDIRECT word { $$ = $2; }
                         ;
 
-errorRedirect           : ERROR_REDIRECT WORD { $$ = $2; }
+errorRedirect           : ERROR_REDIRECT word { $$ = $2; }
                         ;
 
 pipeline                : pipeline OR_STATEMENT command { $$ = addCommandToPipeline($1, $3); }
@@ -111,18 +170,39 @@ pipeline                : pipeline OR_STATEMENT command { $$ = addCommandToPipel
                         ;
 
 command                 : WORD options { $$ = createCommand($1, $2); }
+                        | builtin options { $$ = createBuiltInCommand($1, $2); }    // built-ins can be pipeline stages
                         ;
 
 options                 : options STRING { $$ = addArg($1, $2);}
-                        | options WORD { $$ = addArg($1, $2); }
-                        | options EXIT_KEYWORD { $$ = addArg($1, strdup("exit")); }
-                        | options STATUS_KEYWORD { $$ = addArg($1, strdup("status")); }
-                        | options CD_KEYWORD { $$ = addArg($1, strdup("cd")); }
-                        | options PUSHD_KEYWORD { $$ = addArg($1, strdup("pushd")); }
-                        | options POPD_KEYWORD { $$ = addArg($1, strdup("popd")); }
-                        | options KILL_KEYWORD { $$ = addArg($1, strdup("kill")); }
-                        | options JOBS_KEYWORD { $$ = addArg($1, strdup("jobs")); }
-                        | /* empty */ { $$ = createArgs(); lastArgs = $$; }
+                        | options word { $$ = addArg($1, $2); }
+                        | /* empty */ { $$ = createArgs(); }
+
+// keywords are plain words where no keyword can follow, like arguments and the files of redirections
+word                    : WORD { $$ = $1; }
+                        | keyword { $$ = $1; }
+                        ;
+
+keyword                 : EXIT_KEYWORD { $$ = arenaStrdup(parseArena, "exit"); }
+                        | STATUS_KEYWORD { $$ = arenaStrdup(parseArena, "status"); }
+                        | CD_KEYWORD { $$ = arenaStrdup(parseArena, "cd"); }
+                        | PUSHD_KEYWORD { $$ = arenaStrdup(parseArena, "pushd"); }
+                        | POPD_KEYWORD { $$ = arenaStrdup(parseArena, "popd"); }
+                        | KILL_KEYWORD { $$ = arenaStrdup(parseArena, "kill"); }
+                        | JOBS_KEYWORD { $$ = arenaStrdup(parseArena, "jobs"); }
+                        | HASH_KEYWORD { $$ = arenaStrdup(parseArena, "hash"); }
+                        | TIME_KEYWORD { $$ = arenaStrdup(parseArena, "time"); }
+                        | TIMEOUT_KEYWORD { $$ = arenaStrdup(parseArena, "timeout"); }
+                        | PIPESIZE_KEYWORD { $$ = arenaStrdup(parseArena, "pipesize"); }
+                        | FANOUT_KEYWORD { $$ = arenaStrdup(parseArena, "fanout"); }
+                        | WAIT_KEYWORD { $$ = arenaStrdup(parseArena, "wait"); }
+                        | PARALLEL_KEYWORD { $$ = arenaStrdup(parseArena, "parallel"); }
+                        | LBRACE { $$ = arenaStrdup(parseArena, "{"); }
+                        | RBRACE { $$ = arenaStrdup(parseArena, "}"); }
+                        | FOR_KEYWORD { $$ = arenaStrdup(parseArena, "for"); }
+                        | WHILE_KEYWORD { $$ = arenaStrdup(parseArena, "while"); }
+                        | DO_KEYWORD { $$ = arenaStrdup(parseArena, "do"); }
+                        | DONE_KEYWORD { $$ = arenaStrdup(parseArena, "done"); }
+                        ;
 
 builtin                 : EXIT_KEYWORD { $$ = BIC_EXIT; }
                         | STATUS_KEYWORD { $$ = BIC_STATUS; }
@@ -131,6 +211,10 @@ builtin                 : EXIT_KEYWORD { $$ = BIC_EXIT; }
                         | POPD_KEYWORD { $$ = BIC_POPD; }
                         | KILL_KEYWORD { $$ = BIC_KILL; }
                         | JOBS_KEYWORD { $$ = BIC_JOBS; }
+                        | HASH_KEYWORD { $$ = BIC_HASH; }
+                        | PIPESIZE_KEYWORD { $$ = BIC_PIPESIZE; }
+                        | FANOUT_KEYWORD { $$ = BIC_FANOUT; }
+                        | WAIT_KEYWORD { $$ = BIC_WAIT; }
                         ;
 
 %%
@@ -140,27 +224,66 @@ builtin                 : EXIT_KEYWORD { $$ = BIC_EXIT; }
 
 void finalizeParser() {
     free(status);
-    if (currentPath != NULL) {
-        free(currentPath);
+    if (workingDirectory != NULL) {
+        freeWorkingDirectory(workingDirectory);
     }
     #if EXT_PROMPT
     if (directoryStack != NULL) {
         freeStack(directoryStack);
     }
     #endif
+    finalizeChildReaper();
     if (backgroundList != NULL) {
         freeBackgroundList(backgroundList);
     }
+    if (pathCache != NULL) {
+        freePathCache(pathCache);
+    }
     finalizeLexer();
+    if (parseArena != NULL) {
+        freeArena(parseArena);
+    }
+    finalizeProfile();
+}
+
+// run a chain, or only record it when the script is being compiled
+void dispatchChain(Chain *chain) {
+    endParseSpan();
+    #if EXT_PROMPT
+    if (isCompilingScript()) {
+        recordChain(chain, activeOperator, futureOperator, lexerInputOffset());
+        return;
+    }
+    #endif
+    runChain(chain);
+}
+
+// run a parallel block, or only record it when the script is being compiled
+void dispatchParallel(ChainList *chainList) {
+    endParseSpan();
+    #if EXT_PROMPT
+    if (isCompilingScript()) {
+        recordChainList(chainList, activeOperator, futureOperator, lexerInputOffset());
+        return;
+    }
+    #endif
+    runParallel(chainList);
 }
 
 void yyerror (char *msg) {
+    #if EXT_PROMPT
+    if (isCompilingScript()) {
+        reportCompileError();
+        return;
+    }
+    #endif
     printColor("\033[0;31m", "Error: invalid syntax!\n");
     printPrompt();
 }
 
 int main(int argc, char **argv) {
     // Initialize program
+    parseArena = createArena();
     initLexer();
 
     // initialize the status
@@ -183,9 +306,7 @@ int main(int argc, char **argv) {
     #endif
 
     // Get current path
-    currentPath = malloc(1024 * sizeof(char));
-
-    getcwd(currentPath, 1024 * sizeof(char));
+    workingDirectory = createWorkingDirectory();
 
     printPrompt();
 
@@ -197,6 +318,27 @@ int main(int argc, char **argv) {
     // initialize the background list
     backgroundList = createBackgroundList();
 
+    // measure where the shell spends its time if SHELL_PROFILE is set
+    initProfile();
+
+    // collect finished background processes through a signalfd
+    initChildReaper(backgroundList);
+
+    // initialize the command path cache
+    pathCache = createPathCache();
+
+    // choose the engine used to launch commands
+    initSpawnEngine();
+
+    // choose the engine that moves the data of redirections
+    initPumpEngine();
+
+    // report the resources of every pipeline if SHELL_TIME is set
+    initAccounting();
+
+    // size the pipes between stages as SHELL_PIPE_SIZE asks
+    initPipeSize();
+
     // set the int signal handler for main
     struct sigaction sigint;
     sigemptyset(&sigint.sa_mask);
@@ -205,7 +347,17 @@ int main(int argc, char **argv) {
     sigaction(SIGINT, &sigint, NULL);
 
     // Start parsing process
+    #if EXT_PROMPT
+    // a script runs from its compiled form when it has one
+    if (!scriptInput || !runCachedScript(argv[1])) {
+        yyparse();
+    }
+    #else
     yyparse();
+    #endif
+
+    // the items of background fan-outs are finished before the shell stops
+    waitFanoutRuns();
 
     // Cleanup
     finalizeParser();
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pathcache.h"
+
+// the search path used by execvp when $PATH is not set
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+// hash a command name
+unsigned int hashCommandName(char *name) {
+    unsigned int hash = 2166136261u;
+    for (char *c = name; *c != '\0'; c++) {
+        hash = (hash ^ (unsigned char) *c) * 16777619u;
+    }
+    return hash;
+}
+
+// create an empty cache
+PathCache *createPathCache() {
+    PathCache *cache = malloc(sizeof(PathCache));
+    cache->numBuckets = 64;
+    cache->buckets = calloc(cache->numBuckets, sizeof(PathEntry *));
+    cache->numEntries = 0;
+    cache->pathVariable = NULL;
+    cache->directories = NULL;
+    cache->numDirectories = 0;
+    cache->uncachedPath = NULL;
+    return cache;
+}
+
+// free a resolved command
+void freePathEntry(PathEntry *entry) {
+    free(entry->name);
+    free(entry->path);
+    free(entry);
+}
+
+// remove the commands found in a directory at or after the given index
+void removePathEntriesFrom(PathCache *cache, int directoryIndex) {
+    for (int i = 0; i < cache->numBuckets; i++) {
+        PathEntry **link = &cache->buckets[i];
+        while (*link != NULL) {
+            PathEntry *entry = *link;
+            if (entry->directoryIndex >= directoryIndex) {
+                *link = entry->next;
+                freePathEntry(entry);
+                cache->numEntries--;
+            } else {
+                link = &entry->next;
+            }
+        }
+    }
+}
+
+// remove all commands from the cache
+void clearPathCache(PathCache *cache) {
+    removePathEntriesFrom(cache, 0);
+    for (int i = 0; i < cache->numDirectories; i++) {
+        cache->directories[i].checked = 0;
+    }
+}
+
+// forget the directories of the previous $PATH
+void freePathDirectories(PathCache *cache) {
+    for (int i = 0; i < cache->numDirectories; i++) {
+        free(cache->directories[i].path);
+    }
+    free(cache->directories);
+    free(cache->pathVariable);
+    cache->directories = NULL;
+    cache->numDirectories = 0;
+    cache->pathVariable = NULL;
+}
+
+// split $PATH into directories, an empty entry is the current directory
+void loadPathDirectories(PathCache *cache, char *pathVariable) {
+    freePathDirectories(cache);
+    cache->pathVariable = strdup(pathVariable);
+    int numDirectories = 1;
+    for (char *c = pathVariable; *c != '\0'; c++) {
+        numDirectories += *c == ':';
+    }
+    cache->directories = malloc(numDirectories * sizeof(PathDirectory));
+    char *start = pathVariable;
+    for (int i = 0; i < numDirectories; i++) {
+        char *end = strchr(start, ':');
+        size_t len = end != NULL ? (size_t) (end - start) : strlen(start);
+        cache->directories[i].path = len > 0 ? strndup(start, len) : strdup(".");
+        cache->directories[i].checked = 0;
+        start = end != NULL ? end + 1 : start + len;
+    }
+    cache->numDirectories = numDirectories;
+}
+
+// check if a directory has changed since it was last seen, and remember its state
+int pathDirectoryChanged(PathDirectory *directory) {
+    struct stat info;
+    int exists = stat(directory->path, &info) == 0;
+    int changed = directory->checked && (exists != directory->exists || (exists &&
+        (info.st_mtim.tv_sec != directory->mtime.tv_sec || info.st_mtim.tv_nsec != directory->mtime.tv_nsec)));
+    directory->exists = exists;
+    if (exists) {
+        directory->mtime = info.st_mtim;
+    }
+    directory->checked = 1;
+    return changed;
+}
+
+// check if a file can be executed
+int isExecutableFile(char *path) {
+    struct stat info;
+    return stat(path, &info) == 0 && S_ISREG(info.st_mode) && access(path, X_OK) == 0;
+}
+
+// find the entry of a command
+PathEntry *findPathEntry(PathCache *cache, char *name) {
+    PathEntry *entry = cache->buckets[hashCommandName(name) & (cache->numBuckets - 1)];
+    while (entry != NULL && strcmp(entry->name, name) != 0) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+// double the number of buckets
+void growPathCache(PathCache *cache) {
+    int numBuckets = cache->numBuckets * 2;
+    PathEntry **buckets = calloc(numBuckets, sizeof(PathEntry *));
+    for (int i = 0; i < cache->numBuckets; i++) {
+        PathEntry *entry = cache->buckets[i];
+        while (entry != NULL) {
+            PathEntry *next = entry->next;
+            unsigned int bucket = hashCommandName(entry->name) & (numBuckets - 1);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->numBuckets = numBuckets;
+}
+
+// add a resolved command to the cache
+PathEntry *addPathEntry(PathCache *cache, char *name, char *path, int directoryIndex) {
+    if (cache->numEntries * 4 >= cache->numBuckets * 3) {
+        growPathCache(cache);
+    }
+    PathEntry *entry = malloc(sizeof(PathEntry));
+    entry->name = strdup(name);
+    entry->path = path;
+    entry->directoryIndex = directoryIndex;
+    entry->hits = 0;
+    unsigned int bucket = hashCommandName(name) & (cache->numBuckets - 1);
+    entry->next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    cache->numEntries++;
+    return entry;
+}
+
+// search the directories of $PATH for a command
+char *searchCommandPath(PathCache *cache, char *name, int *directoryIndex) {
+    size_t nameLength = strlen(name);
+    for (int i = 0; i < cache->numDirectories; i++) {
+        PathDirectory *directory = &cache->directories[i];
+        if (pathDirectoryChanged(directory)) {
+            removePathEntriesFrom(cache, i);
+        }
+        if (!directory->exists) {
+            continue;
+        }
+        size_t directoryLength = strlen(directory->path);
+        char *path = malloc(directoryLength + nameLength + 2);
+        memcpy(path, directory->path, directoryLength);
+        path[directoryLength] = '/';
+        memcpy(path + directoryLength + 1, name, nameLength + 1);
+        if (isExecutableFile(path)) {
+            *directoryIndex = i;
+            return path;
+        }
+        free(path);
+    }
+    return NULL;
+}
+
+// get the path of a command, or NULL if it cannot be found
+char *lookupCommandPath(PathCache *cache, char *name) {
+    // names with a slash are not searched
+    if (strchr(name, '/') != NULL) {
+        return isExecutableFile(name) ? name : NULL;
+    }
+
+    // forget everything when $PATH changes
+    char *pathVariable = getenv("PATH");
+    if (pathVariable == NULL) {
+        pathVariable = DEFAULT_PATH;
+    }
+    if (cache->pathVariable == NULL || strcmp(cache->pathVariable, pathVariable) != 0) {
+        removePathEntriesFrom(cache, 0);
+        loadPathDirectories(cache, pathVariable);
+    }
+
+    PathEntry *entry = findPathEntry(cache, name);
+    if (entry != NULL) {
+        // a change in an earlier directory can shadow the command, a change in its own can remove it
+        for (int i = 0; i <= entry->directoryIndex; i++) {
+            if (pathDirectoryChanged(&cache->directories[i])) {
+                removePathEntriesFrom(cache, i);
+                entry = NULL;
+                break;
+            }
+        }
+    }
+    if (entry == NULL) {
+        int directoryIndex;
+        char *path = searchCommandPath(cache, name, &directoryIndex);
+        if (path == NULL) {
+            return NULL;
+        }
+        // relative directories depend on the working directory, so they are not remembered
+        if (cache->directories[directoryIndex].path[0] != '/') {
+            free(cache->uncachedPath);
+            cache->uncachedPath = path;
+            return path;
+        }
+        entry = addPathEntry(cache, name, path, directoryIndex);
+    }
+    entry->hits++;
+    return entry->path;
+}
+
+// check if the cache is empty
+int isEmptyPathCache(PathCache *cache) {
+    return cache->numEntries == 0;
+}
+
+// print the cached commands
+void printPathCache(PathCache *cache) {
+    fprintf(stdout, "hits\tcommand\n");
+    for (int i = 0; i < cache->numBuckets; i++) {
+        for (PathEntry *entry = cache->buckets[i]; entry != NULL; entry = entry->next) {
+            fprintf(stdout, "%4d\t%s\n", entry->hits, entry->path);
+        }
+    }
+}
+
+// free the cache
+void freePathCache(PathCache *cache) {
+    removePathEntriesFrom(cache, 0);
+    freePathDirectories(cache);
+    free(cache->uncachedPath);
+    free(cache->buckets);
+    free(cache);
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <time.h>
+
+// structure for a resolved command
+typedef struct PathEntry {
+    char *name;
+    char *path;
+    int directoryIndex;
+    int hits;
+    struct PathEntry *next;
+} PathEntry;
+
+// structure for a directory of $PATH
+typedef struct PathDirectory {
+    char *path;
+    struct timespec mtime;
+    int exists;
+    int checked;
+} PathDirectory;
+
+// structure for the cache
+typedef struct PathCache {
+    PathEntry **buckets;
+    int numBuckets;
+    int numEntries;
+    char *pathVariable;
+    PathDirectory *directories;
+    int numDirectories;
+    char *uncachedPath;
+} PathCache;
+
+PathCache *createPathCache();
+char *lookupCommandPath(PathCache *cache, char *name);
+void printPathCache(PathCache *cache);
+int isEmptyPathCache(PathCache *cache);
+void clearPathCache(PathCache *cache);
+void freePathCache(PathCache *cache);
+
+#endif
\ No newline at end of file
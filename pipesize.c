@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pipesize.h"
+
+// context switches per second and pipe above which auto mode grows the pipes
+#define PIPE_SIZE_SWITCH_RATE 2000
+// pipelines shorter than this are not used to size the pipes
+#define PIPE_SIZE_MIN_SAMPLE 0.05
+
+PipeSizeMode pipeSizeMode = PS_DEFAULT;
+// the size of fixed mode, or the size auto mode has settled on
+int pipeSize = PIPE_SIZE_DEFAULT;
+// the largest size an unprivileged process may set
+int maxPipeSize = 0;
+
+// read the largest pipe size from the kernel
+int getMaxPipeSize() {
+    if (maxPipeSize == 0) {
+        maxPipeSize = 1048576;
+        FILE *file = fopen("/proc/sys/fs/pipe-max-size", "r");
+        if (file != NULL) {
+            if (fscanf(file, "%d", &maxPipeSize) != 1 || maxPipeSize < PIPE_SIZE_DEFAULT) {
+                maxPipeSize = 1048576;
+            }
+            fclose(file);
+        }
+    }
+    return maxPipeSize;
+}
+
+// set the mode from a value like "default", "auto", "max", "1048576", "256K" or "4M", returns 0 if it is invalid
+int setPipeSize(char *value) {
+    if (strcasecmp(value, "default") == 0) {
+        pipeSizeMode = PS_DEFAULT;
+        pipeSize = PIPE_SIZE_DEFAULT;
+        return 1;
+    }
+    if (strcasecmp(value, "auto") == 0) {
+        pipeSizeMode = PS_AUTO;
+        pipeSize = PIPE_SIZE_DEFAULT;
+        return 1;
+    }
+    if (strcasecmp(value, "max") == 0) {
+        pipeSizeMode = PS_FIXED;
+        pipeSize = getMaxPipeSize();
+        return 1;
+    }
+    char *endPtr = NULL;
+    long size = strtol(value, &endPtr, 10);
+    if (endPtr == value) {
+        return 0;
+    }
+    if (*endPtr == 'k' || *endPtr == 'K') {
+        size *= 1024;
+        endPtr++;
+    } else if (*endPtr == 'm' || *endPtr == 'M') {
+        size *= 1024 * 1024;
+        endPtr++;
+    }
+    if (*endPtr != '\0' || size < 4096 || size > getMaxPipeSize()) {
+        return 0;
+    }
+    pipeSizeMode = PS_FIXED;
+    pipeSize = size;
+    return 1;
+}
+
+// read the mode from SHELL_PIPE_SIZE
+void initPipeSize() {
+    char *value = getenv("SHELL_PIPE_SIZE");
+    if (value != NULL && value[0] != '\0' && !setPipeSize(value)) {
+        fprintf(stderr, "SHELL_PIPE_SIZE: invalid pipe size, using the default\n");
+    }
+}
+
+// print the current mode
+void printPipeSize() {
+    if (pipeSizeMode == PS_DEFAULT) {
+        printf("Pipe size: default (%d bytes)\n", PIPE_SIZE_DEFAULT);
+    } else if (pipeSizeMode == PS_FIXED) {
+        printf("Pipe size: %d bytes\n", pipeSize);
+    } else {
+        printf("Pipe size: auto (currently %d bytes, at most %d bytes)\n", pipeSize, getMaxPipeSize());
+    }
+}
+
+// give a new pipe the configured capacity, the kernel default is kept if it cannot be set
+void sizePipe(int fd) {
+    if (pipeSizeMode != PS_DEFAULT && pipeSize != PIPE_SIZE_DEFAULT) {
+        fcntl(fd, F_SETPIPE_SZ, pipeSize);
+    }
+}
+
+// check if the pipes are sized from how pipelines behave
+int isAutoPipeSize() {
+    return pipeSizeMode == PS_AUTO;
+}
+
+// remember the children's context switches before a pipeline starts
+void startPipeSizeSample(PipeSizeSample *sample) {
+    getrusage(RUSAGE_CHILDREN, &sample->usage);
+    clock_gettime(CLOCK_MONOTONIC, &sample->startTime);
+}
+
+// grow the pipes when the finished pipeline switched often, shrink them when it hardly did
+void finishPipeSizeSample(PipeSizeSample *sample, int numPipes) {
+    struct rusage usage;
+    struct timespec now;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - sample->startTime.tv_sec) + (now.tv_nsec - sample->startTime.tv_nsec) / 1e9;
+    if (numPipes == 0 || elapsed < PIPE_SIZE_MIN_SAMPLE) {
+        return;
+    }
+    long switches = (usage.ru_nvcsw - sample->usage.ru_nvcsw) + (usage.ru_nivcsw - sample->usage.ru_nivcsw);
+    double rate = switches / elapsed / numPipes;
+    if (rate > PIPE_SIZE_SWITCH_RATE && pipeSize < getMaxPipeSize()) {
+        pipeSize = pipeSize * 4 < getMaxPipeSize() ? pipeSize * 4 : getMaxPipeSize();
+    } else if (rate < PIPE_SIZE_SWITCH_RATE / 8 && pipeSize > PIPE_SIZE_DEFAULT) {
+        pipeSize = pipeSize / 2 > PIPE_SIZE_DEFAULT ? pipeSize / 2 : PIPE_SIZE_DEFAULT;
+    }
+}
\ No newline at end of file
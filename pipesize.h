@@ -0,0 +1,31 @@
+#ifndef PIPESIZE_H
+#define PIPESIZE_H
+
+#include <time.h>
+#include <sys/resource.h>
+
+// the size the kernel gives a new pipe
+#define PIPE_SIZE_DEFAULT 65536
+
+// ways of sizing the pipes between stages
+typedef enum PipeSizeMode {
+    PS_DEFAULT,
+    PS_FIXED,
+    PS_AUTO
+} PipeSizeMode;
+
+// structure for measuring how often a pipeline switched context
+typedef struct PipeSizeSample {
+    struct rusage usage;
+    struct timespec startTime;
+} PipeSizeSample;
+
+void initPipeSize();
+int setPipeSize(char *value);
+void printPipeSize();
+void sizePipe(int fd);
+int isAutoPipeSize();
+void startPipeSizeSample(PipeSizeSample *sample);
+void finishPipeSizeSample(PipeSizeSample *sample, int numPipes);
+
+#endif
\ No newline at end of file
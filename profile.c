@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "profile.h"
+
+// the names of the spans, in the order of ProfileSpanType
+char *profileSpanNames[] = { "input", "lex", "parse", "chain", "builtin", "spawn", "wait", "pump" };
+
+// how the shell is profiled, set with SHELL_PROFILE
+ProfileMode profileMode = PM_OFF;
+char *profileTracePath = NULL;
+// only the shell itself reports, not the subshells it forks
+pid_t profilePid = 0;
+long long profileStart = 0;
+ProfileTotal profileTotals[PF_NUM_TYPES];
+ProfileEvent *profileEvents = NULL;
+int numProfileEvents = 0;
+int profileEventsCapacity = 0;
+// the start of the input line being parsed, 0 while none is
+long long parseStart = 0;
+
+// get the monotonic time in nanoseconds
+long long profileNow() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000000LL + time.tv_nsec;
+}
+
+// make the path of the trace absolute, it is written at exit after the script may have changed directory
+char *absoluteTracePath(char *path) {
+    char *directory = path[0] != '/' ? getcwd(NULL, 0) : NULL;
+    if (directory == NULL) {
+        return strdup(path);
+    }
+    size_t len = strlen(directory) + strlen(path) + 2;
+    char *absolute = malloc(len);
+    snprintf(absolute, len, "%s/%s", directory, path);
+    free(directory);
+    return absolute;
+}
+
+// read the profile mode from the environment, SHELL_PROFILE=summary or the path of a trace file
+void initProfile() {
+    char *mode = getenv("SHELL_PROFILE");
+    if (mode == NULL || mode[0] == '\0' || strcmp(mode, "0") == 0) {
+        profileMode = PM_OFF;
+        return;
+    }
+    if (strcmp(mode, "summary") == 0 || strcmp(mode, "1") == 0) {
+        profileMode = PM_SUMMARY;
+    } else {
+        profileMode = PM_TRACE;
+        profileTracePath = absoluteTracePath(mode);
+    }
+    memset(profileTotals, 0, sizeof(profileTotals));
+    profilePid = getpid();
+    profileStart = profileNow();
+}
+
+// start a span, returns 0 when the shell is not profiled so ending it costs nothing
+long long startProfileSpan() {
+    if (profileMode == PM_OFF) {
+        return 0;
+    }
+    return profileNow();
+}
+
+// end a span and add it to the totals and the trace
+void endProfileSpan(ProfileSpanType type, long long start, char *detail) {
+    if (start == 0) {
+        return;
+    }
+    long long duration = profileNow() - start;
+    ProfileTotal *total = &profileTotals[type];
+    total->count++;
+    total->totalTime += duration;
+    if (duration > total->maxTime) {
+        total->maxTime = duration;
+    }
+    // tokens are too many and too short to be traced one by one
+    if (profileMode != PM_TRACE || type == PF_LEX) {
+        return;
+    }
+    if (numProfileEvents == profileEventsCapacity) {
+        profileEventsCapacity = profileEventsCapacity == 0 ? 1024 : profileEventsCapacity * 2;
+        profileEvents = realloc(profileEvents, profileEventsCapacity * sizeof(ProfileEvent));
+    }
+    ProfileEvent *event = &profileEvents[numProfileEvents++];
+    event->type = type;
+    event->start = start;
+    event->duration = duration;
+    event->detail = detail != NULL ? strdup(detail) : NULL;
+}
+
+// start the parse span of an input line at its first token
+void startParseSpan() {
+    if (profileMode != PM_OFF && parseStart == 0) {
+        parseStart = profileNow();
+    }
+}
+
+// end the parse span when the parsed chain is dispatched
+void endParseSpan() {
+    endProfileSpan(PF_PARSE, parseStart, NULL);
+    parseStart = 0;
+}
+
+// print the totals of every span to stderr
+void printProfileSummary() {
+    fprintf(stderr, "%-10s %10s %12s %12s %12s\n", "span", "count", "total ms", "avg us", "max us");
+    for (int i = 0; i < PF_NUM_TYPES; i++) {
+        ProfileTotal *total = &profileTotals[i];
+        if (total->count == 0) {
+            continue;
+        }
+        fprintf(stderr, "%-10s %10lld %12.3f %12.3f %12.3f\n", profileSpanNames[i], total->count,
+                total->totalTime / 1e6, total->totalTime / 1e3 / total->count, total->maxTime / 1e3);
+    }
+    fprintf(stderr, "%-10s %10s %12.3f\n", "session", "", (profileNow() - profileStart) / 1e6);
+}
+
+// write a string as a JSON string
+void writeJsonString(FILE *file, char *string) {
+    fputc('"', file);
+    for (unsigned char *c = (unsigned char *) string; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// write the spans as a Chrome trace, which chrome://tracing and Perfetto can open
+void writeProfileTrace() {
+    FILE *file = fopen(profileTracePath, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: the profile could not be written!\n");
+        return;
+    }
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (int i = 0; i < numProfileEvents; i++) {
+        ProfileEvent *event = &profileEvents[i];
+        fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"shell\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+                i > 0 ? ",\n" : "", profileSpanNames[event->type], (event->start - profileStart) / 1e3,
+                event->duration / 1e3, (int) profilePid, (int) profilePid);
+        if (event->detail != NULL) {
+            fprintf(file, ",\"args\":{\"detail\":");
+            writeJsonString(file, event->detail);
+            fputc('}', file);
+        }
+        fputc('}', file);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+}
+
+// report the profile when the shell stops
+void finalizeProfile() {
+    if (profileMode == PM_OFF || getpid() != profilePid) {
+        return;
+    }
+    if (profileMode == PM_SUMMARY) {
+        printProfileSummary();
+    } else {
+        writeProfileTrace();
+    }
+    for (int i = 0; i < numProfileEvents; i++) {
+        free(profileEvents[i].detail);
+    }
+    free(profileEvents);
+    free(profileTracePath);
+    profileEvents = NULL;
+    profileTracePath = NULL;
+    numProfileEvents = 0;
+    profileMode = PM_OFF;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// parts of the shell that are measured
+typedef enum ProfileSpanType {
+    PF_INPUT,
+    PF_LEX,
+    PF_PARSE,
+    PF_CHAIN,
+    PF_BUILTIN,
+    PF_SPAWN,
+    PF_WAIT,
+    PF_PUMP,
+    PF_NUM_TYPES
+} ProfileSpanType;
+
+// ways the measurements are reported
+typedef enum ProfileMode {
+    PM_OFF,
+    PM_SUMMARY,
+    PM_TRACE
+} ProfileMode;
+
+// structure for one measured span, kept for the trace
+typedef struct ProfileEvent {
+    ProfileSpanType type;
+    long long start;
+    long long duration;
+    char *detail;
+} ProfileEvent;
+
+// structure for the totals of a type of span
+typedef struct ProfileTotal {
+    long long count;
+    long long totalTime;
+    long long maxTime;
+} ProfileTotal;
+
+void initProfile();
+long long startProfileSpan();
+void endProfileSpan(ProfileSpanType type, long long start, char *detail);
+void startParseSpan();
+void endParseSpan();
+void finalizeProfile();
+
+#endif
\ No newline at end of file
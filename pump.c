@@ -0,0 +1,540 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+
+#include "pump.h"
+
+// the most data moved by one splice
+#define PUMP_CHUNK (1 << 20)
+// the size of the buffer used when splice is not supported
+#define PUMP_BUFFER (64 * 1024)
+// the size of the blocks moved by the io_uring engine
+#define PUMP_RING_BUFFER (1 << 20)
+// the number of operations the ring holds, and how many writes of a fan-out go in one batch
+#define PUMP_RING_ENTRIES 64
+#define PUMP_RING_BATCH 32
+
+// the engine used to move data, the ring is set up the first time it is needed
+PumpEngine pumpEngine = PE_SPLICE;
+IoRing pumpRing;
+// 0 until the ring is set up, -1 if io_uring is not available
+int pumpRingState = 0;
+
+// choose the engine, SHELL_IO_ENGINE=uring asks for io_uring
+void initPumpEngine() {
+    char *engine = getenv("SHELL_IO_ENGINE");
+    if (engine != NULL && (strcmp(engine, "uring") == 0 || strcmp(engine, "io_uring") == 0)) {
+        pumpEngine = PE_URING;
+    } else {
+        pumpEngine = PE_SPLICE;
+    }
+}
+
+// set the engine used to move data
+void setPumpEngine(PumpEngine engine) {
+    pumpEngine = engine;
+}
+
+// get the engine used to move data, io_uring falls back to splice once it turns out to be unavailable
+PumpEngine getPumpEngine() {
+    return pumpEngine;
+}
+
+// get the ring of the io_uring engine, NULL if the engine is not used
+IoRing *getPumpRing() {
+    if (pumpEngine != PE_URING) {
+        return NULL;
+    }
+    if (pumpRingState == 0) {
+        pumpRingState = initIoRing(&pumpRing, PUMP_RING_ENTRIES) ? 1 : -1;
+    }
+    if (pumpRingState == -1) {
+        // the kernel has no io_uring or it is disabled, use splice instead
+        pumpEngine = PE_SPLICE;
+        return NULL;
+    }
+    return &pumpRing;
+}
+
+// create a fan-out that copies nothing
+void initOutputFanout(OutputFanout *fanout) {
+    fanout->pipe = -1;
+    fanout->files = NULL;
+    fanout->numFiles = 0;
+    fanout->scratch[0] = -1;
+    fanout->scratch[1] = -1;
+    fanout->copied = NULL;
+    fanout->buffer = NULL;
+    fanout->bytesWritten = 0;
+    fanout->ring = NULL;
+    fanout->requests = NULL;
+}
+
+// create a pump that moves nothing
+void initPump(Pump *pump) {
+    pump->input.files = NULL;
+    pump->input.numFiles = 0;
+    pump->input.currentFile = 0;
+    pump->input.pipe = -1;
+    pump->input.newlinePending = 0;
+    pump->input.buffer = NULL;
+    pump->input.bufferStart = 0;
+    pump->input.bufferEnd = 0;
+    pump->input.ring = NULL;
+    pump->input.readAhead = NULL;
+    pump->input.readPending = 0;
+    initOutputFanout(&pump->output);
+    initOutputFanout(&pump->error);
+    pump->usage = NULL;
+}
+
+// feed the files into a new pipe and return its read end, the pump owns the files
+int addInputFeed(Pump *pump, int *files, int numFiles) {
+    int pipeInput[2];
+    if (pipe2(pipeInput, O_CLOEXEC) < 0) {
+        return -1;
+    }
+    // only the shell writes, so only its end is non-blocking
+    fcntl(pipeInput[1], F_SETFL, O_NONBLOCK);
+    pump->input.files = files;
+    pump->input.numFiles = numFiles;
+    pump->input.currentFile = 0;
+    pump->input.pipe = pipeInput[1];
+    pump->input.newlinePending = 0;
+    pump->input.ring = getPumpRing();
+    if (pump->input.ring != NULL) {
+        pump->input.buffer = malloc(PUMP_RING_BUFFER);
+        pump->input.readAhead = malloc(PUMP_RING_BUFFER);
+        pump->input.bufferStart = 0;
+        pump->input.bufferEnd = 0;
+        pump->input.readPending = 0;
+    }
+    return pipeInput[0];
+}
+
+// copy everything written into a new pipe to all files and return its write end, the fan-out owns the files
+int addOutputFanout(OutputFanout *fanout, int *files, int numFiles) {
+    int pipeOutput[2];
+    if (pipe2(pipeOutput, O_CLOEXEC) < 0) {
+        return -1;
+    }
+    // only the shell reads, so only its end is non-blocking
+    fcntl(pipeOutput[0], F_SETFL, O_NONBLOCK);
+    fanout->pipe = pipeOutput[0];
+    fanout->files = files;
+    fanout->numFiles = numFiles;
+    fanout->copied = malloc(numFiles * sizeof(ssize_t));
+    fanout->bytesWritten = 0;
+    fanout->ring = getPumpRing();
+    if (fanout->ring != NULL) {
+        // the ring writes every copy from one large buffer, tee is not used
+        fanout->scratch[0] = -1;
+        fanout->scratch[1] = -1;
+        fanout->buffer = malloc(PUMP_RING_BUFFER);
+        fanout->requests = malloc(numFiles * sizeof(IoRingRequest));
+    } else if (pipe2(fanout->scratch, O_CLOEXEC) == 0) {
+        // tee needs a second pipe with as many slots as the first one
+        fcntl(fanout->scratch[1], F_SETPIPE_SZ, fcntl(pipeOutput[0], F_GETPIPE_SZ));
+    } else {
+        fanout->scratch[0] = -1;
+        fanout->scratch[1] = -1;
+        fanout->buffer = malloc(PUMP_BUFFER);
+    }
+    return pipeOutput[1];
+}
+
+// check if the pump still has data to move
+int isActivePump(Pump *pump) {
+    return pump->input.pipe != -1 || pump->output.pipe != -1 || pump->error.pipe != -1;
+}
+
+// close the pipe and the remaining files of the feed
+void finishInputFeed(InputFeed *feed) {
+    // the kernel may still be reading into the read-ahead buffer
+    if (feed->readPending) {
+        waitIoRingRequest(feed->ring, &feed->readRequest);
+        feed->readPending = 0;
+    }
+    for (int i = feed->currentFile; i < feed->numFiles; i++) {
+        close(feed->files[i]);
+    }
+    close(feed->pipe);
+    free(feed->files);
+    free(feed->buffer);
+    free(feed->readAhead);
+    feed->files = NULL;
+    feed->buffer = NULL;
+    feed->readAhead = NULL;
+    feed->ring = NULL;
+    feed->pipe = -1;
+}
+
+// copy from the current file into the pipe through the buffer
+ssize_t copyInputBuffer(InputFeed *feed) {
+    if (feed->bufferStart == feed->bufferEnd) {
+        ssize_t len = read(feed->files[feed->currentFile], feed->buffer, PUMP_BUFFER);
+        if (len <= 0) {
+            return len;
+        }
+        feed->bufferStart = 0;
+        feed->bufferEnd = len;
+    }
+    ssize_t len = write(feed->pipe, feed->buffer + feed->bufferStart, feed->bufferEnd - feed->bufferStart);
+    if (len > 0) {
+        feed->bufferStart += len;
+    }
+    return len;
+}
+
+// start reading the next block of the current file into the read-ahead buffer
+void startRingRead(InputFeed *feed) {
+    if (queueIoRingRead(feed->ring, feed->files[feed->currentFile], feed->readAhead, PUMP_RING_BUFFER, &feed->readRequest)) {
+        submitIoRing(feed->ring);
+        feed->readPending = 1;
+    }
+}
+
+// copy from the current file into the pipe, the ring reads the next block while this one is written
+ssize_t copyInputRing(InputFeed *feed) {
+    if (feed->bufferStart == feed->bufferEnd) {
+        if (!feed->readPending) {
+            startRingRead(feed);
+        }
+        int result = feed->readPending ? waitIoRingRequest(feed->ring, &feed->readRequest) : -EBUSY;
+        feed->readPending = 0;
+        if (result <= 0) {
+            errno = -result;
+            return result < 0 ? -1 : 0;
+        }
+        char *block = feed->readAhead;
+        feed->readAhead = feed->buffer;
+        feed->buffer = block;
+        feed->bufferStart = 0;
+        feed->bufferEnd = result;
+        // the end of the file is found by the read ahead
+        startRingRead(feed);
+    }
+    ssize_t len = write(feed->pipe, feed->buffer + feed->bufferStart, feed->bufferEnd - feed->bufferStart);
+    if (len > 0) {
+        feed->bufferStart += len;
+    }
+    return len;
+}
+
+// stop using the ring for the feed, the rest is copied through the buffer
+void stopInputRing(InputFeed *feed) {
+    if (feed->readPending) {
+        waitIoRingRequest(feed->ring, &feed->readRequest);
+        feed->readPending = 0;
+    }
+    free(feed->readAhead);
+    feed->readAhead = NULL;
+    feed->ring = NULL;
+}
+
+// move data from the files into the pipe until the pipe is full
+void pumpInputFeed(InputFeed *feed) {
+    while (feed->pipe != -1) {
+        ssize_t len;
+        if (feed->newlinePending) {
+            // every file is followed by a newline
+            len = write(feed->pipe, "\n", 1);
+            if (len == 1) {
+                feed->newlinePending = 0;
+                close(feed->files[feed->currentFile]);
+                feed->currentFile++;
+                if (feed->currentFile == feed->numFiles) {
+                    finishInputFeed(feed);
+                }
+                continue;
+            }
+        } else if (feed->ring != NULL) {
+            len = copyInputRing(feed);
+            if (len < 0 && (errno == EINVAL || errno == EOPNOTSUPP || errno == EBUSY)) {
+                // the ring cannot read the file, copy it instead
+                stopInputRing(feed);
+                continue;
+            }
+        } else if (feed->buffer == NULL) {
+            len = splice(feed->files[feed->currentFile], NULL, feed->pipe, NULL, PUMP_CHUNK, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (len < 0 && errno == EINVAL) {
+                // the file cannot be spliced, copy it instead
+                feed->buffer = malloc(PUMP_BUFFER);
+                feed->bufferStart = 0;
+                feed->bufferEnd = 0;
+                continue;
+            }
+        } else {
+            len = copyInputBuffer(feed);
+        }
+        if (len == 0) {
+            feed->newlinePending = 1;
+        } else if (len < 0 && errno == EAGAIN) {
+            return;
+        } else if (len < 0 && errno != EINTR) {
+            // the reader is gone or the file cannot be read
+            finishInputFeed(feed);
+        }
+    }
+}
+
+// close the pipes and the files of the fan-out
+void finishOutputFanout(OutputFanout *fanout) {
+    for (int i = 0; i < fanout->numFiles; i++) {
+        close(fanout->files[i]);
+    }
+    close(fanout->pipe);
+    if (fanout->scratch[0] != -1) {
+        close(fanout->scratch[0]);
+        close(fanout->scratch[1]);
+    }
+    free(fanout->files);
+    free(fanout->copied);
+    free(fanout->buffer);
+    free(fanout->requests);
+    fanout->requests = NULL;
+    fanout->ring = NULL;
+    fanout->files = NULL;
+    fanout->copied = NULL;
+    fanout->buffer = NULL;
+    fanout->pipe = -1;
+}
+
+// write the whole buffer to a file
+void writeAll(int file, char *buffer, ssize_t len) {
+    while (len > 0) {
+        ssize_t written = write(file, buffer, len);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return;
+        }
+        buffer += written;
+        len -= written;
+    }
+}
+
+// move len bytes from a pipe into a file
+void drainPipe(OutputFanout *fanout, int pipe, int file, ssize_t len) {
+    while (len > 0) {
+        ssize_t moved = splice(pipe, NULL, file, NULL, len, SPLICE_F_MOVE);
+        if (moved < 0 && errno == EINTR) {
+            continue;
+        }
+        if (moved <= 0) {
+            // the file cannot be spliced into, copy the rest instead
+            if (fanout->buffer == NULL) {
+                fanout->buffer = malloc(PUMP_BUFFER);
+            }
+            while (len > 0) {
+                moved = read(pipe, fanout->buffer, len < PUMP_BUFFER ? len : PUMP_BUFFER);
+                if (moved < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (moved <= 0) {
+                    return;
+                }
+                writeAll(file, fanout->buffer, moved);
+                len -= moved;
+            }
+            return;
+        }
+        len -= moved;
+    }
+}
+
+// copy one chunk from the pipe into every file through the scratch pipe, returns the chunk size
+ssize_t teeOutputChunk(OutputFanout *fanout) {
+    ssize_t len = tee(fanout->pipe, fanout->scratch[1], PUMP_BUFFER, SPLICE_F_NONBLOCK);
+    if (len <= 0) {
+        return len;
+    }
+    // every file but the first gets a copy, the first one gets the original data
+    int shortCopy = 0;
+    for (int i = 1; i < fanout->numFiles; i++) {
+        fanout->copied[i] = i == 1 ? len : tee(fanout->pipe, fanout->scratch[1], len, SPLICE_F_NONBLOCK);
+        if (fanout->copied[i] < 0) {
+            fanout->copied[i] = 0;
+        }
+        shortCopy |= fanout->copied[i] < len;
+        drainPipe(fanout, fanout->scratch[0], fanout->files[i], fanout->copied[i]);
+    }
+    if (!shortCopy) {
+        drainPipe(fanout, fanout->pipe, fanout->files[0], len);
+    } else {
+        // a copy was cut short, finish the chunk from a buffer
+        if (fanout->buffer == NULL) {
+            fanout->buffer = malloc(PUMP_BUFFER);
+        }
+        ssize_t done = 0;
+        while (done < len) {
+            ssize_t moved = read(fanout->pipe, fanout->buffer + done, len - done);
+            if (moved < 0 && errno == EINTR) {
+                continue;
+            }
+            if (moved <= 0) {
+                break;
+            }
+            done += moved;
+        }
+        writeAll(fanout->files[0], fanout->buffer, done);
+        for (int i = 1; i < fanout->numFiles; i++) {
+            if (fanout->copied[i] < done) {
+                writeAll(fanout->files[i], fanout->buffer + fanout->copied[i], done - fanout->copied[i]);
+            }
+        }
+    }
+    fanout->bytesWritten += len * fanout->numFiles;
+    return len;
+}
+
+// copy one chunk from the pipe into every file through the buffer, returns the chunk size
+ssize_t copyOutputChunk(OutputFanout *fanout) {
+    ssize_t len = read(fanout->pipe, fanout->buffer, PUMP_BUFFER);
+    if (len <= 0) {
+        return len;
+    }
+    for (int i = 0; i < fanout->numFiles; i++) {
+        writeAll(fanout->files[i], fanout->buffer, len);
+    }
+    fanout->bytesWritten += len * fanout->numFiles;
+    return len;
+}
+
+// copy one chunk from the pipe into every file with batches of writes on the ring, returns the chunk size
+ssize_t ringOutputChunk(OutputFanout *fanout) {
+    // take as much as the pipe holds, so the batches are large
+    ssize_t len = 0;
+    while (len < PUMP_RING_BUFFER) {
+        ssize_t got = read(fanout->pipe, fanout->buffer + len, PUMP_RING_BUFFER - len);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            if (len == 0) {
+                return got;
+            }
+            break;
+        }
+        len += got;
+    }
+
+    for (int first = 0; first < fanout->numFiles; first += PUMP_RING_BATCH) {
+        int last = first + PUMP_RING_BATCH < fanout->numFiles ? first + PUMP_RING_BATCH : fanout->numFiles;
+        for (int i = first; i < last; i++) {
+            fanout->copied[i] = 0;
+        }
+        // short writes are queued again until every file has the chunk
+        int queued = 1;
+        while (queued) {
+            queued = 0;
+            for (int i = first; i < last; i++) {
+                if (fanout->copied[i] >= len) {
+                    continue;
+                }
+                if (queueIoRingWrite(fanout->ring, fanout->files[i], fanout->buffer + fanout->copied[i], len - fanout->copied[i], &fanout->requests[i])) {
+                    queued++;
+                } else {
+                    // the ring is full, write this copy directly
+                    writeAll(fanout->files[i], fanout->buffer + fanout->copied[i], len - fanout->copied[i]);
+                    fanout->copied[i] = len;
+                }
+            }
+            submitIoRing(fanout->ring);
+            for (int i = first; i < last && queued; i++) {
+                if (fanout->copied[i] >= len) {
+                    continue;
+                }
+                int result = waitIoRingRequest(fanout->ring, &fanout->requests[i]);
+                if (result == -EINVAL || result == -EOPNOTSUPP) {
+                    // the ring cannot write the file, write it directly
+                    writeAll(fanout->files[i], fanout->buffer + fanout->copied[i], len - fanout->copied[i]);
+                    result = len - fanout->copied[i];
+                }
+                // a file that takes no more data is given up, like writeAll does
+                fanout->copied[i] = result > 0 ? fanout->copied[i] + result : len;
+            }
+        }
+    }
+    fanout->bytesWritten += len * fanout->numFiles;
+    return len;
+}
+
+// copy data from the pipe into the files until the pipe is empty
+void pumpOutputFanout(OutputFanout *fanout) {
+    while (fanout->pipe != -1) {
+        ssize_t len;
+        if (fanout->ring != NULL) {
+            len = ringOutputChunk(fanout);
+        } else if (fanout->scratch[0] != -1) {
+            len = teeOutputChunk(fanout);
+            if (len < 0 && errno == EINVAL) {
+                // the pipe cannot be teed, copy it instead
+                close(fanout->scratch[0]);
+                close(fanout->scratch[1]);
+                fanout->scratch[0] = -1;
+                fanout->scratch[1] = -1;
+                if (fanout->buffer == NULL) {
+                    fanout->buffer = malloc(PUMP_BUFFER);
+                }
+                continue;
+            }
+        } else {
+            len = copyOutputChunk(fanout);
+        }
+        if (len == 0) {
+            // every writer is finished
+            finishOutputFanout(fanout);
+        } else if (len < 0 && errno == EAGAIN) {
+            return;
+        } else if (len < 0 && errno != EINTR) {
+            finishOutputFanout(fanout);
+        }
+    }
+}
+
+// move data while the pipeline runs, until every feed and fan-out is finished
+// the time limit of the pipeline, if there is one, is watched meanwhile as its stages may never close their pipes
+void runPump(Pump *pump, Deadline *deadline) {
+    if (!isActivePump(pump)) {
+        return;
+    }
+    // a reader that exits early should end its feed, not the shell
+    struct sigaction sigpipe, previous;
+    sigemptyset(&sigpipe.sa_mask);
+    sigpipe.sa_flags = SA_RESTART;
+    sigpipe.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sigpipe, &previous);
+
+    // the stages are watched next to the pipes
+    struct pollfd *ready = malloc((4 + (pump->usage != NULL ? pump->usage->numStages : 0)) * sizeof(struct pollfd));
+    while (isActivePump(pump)) {
+        pumpInputFeed(&pump->input);
+        pumpOutputFanout(&pump->output);
+        pumpOutputFanout(&pump->error);
+        // wait until one of the pipes can make progress, finished pipes are ignored by poll
+        ready[0] = (struct pollfd) { pump->input.pipe, POLLOUT, 0 };
+        ready[1] = (struct pollfd) { pump->output.pipe, POLLIN, 0 };
+        ready[2] = (struct pollfd) { pump->error.pipe, POLLIN, 0 };
+        ready[3] = (struct pollfd) { deadline != NULL && !deadline->expired ? deadline->timer : -1, POLLIN, 0 };
+        int numStages = pump->usage != NULL ? addStageWatches(pump->usage, ready + 4) : 0;
+        if (isActivePump(pump)) {
+            poll(ready, 4 + numStages, -1);
+            if (deadline != NULL) {
+                checkDeadline(deadline);
+            }
+            if (numStages > 0) {
+                collectExitedStages(pump->usage, ready + 4, numStages);
+            }
+        }
+    }
+    free(ready);
+
+    sigaction(SIGPIPE, &previous, NULL);
+}
\ No newline at end of file
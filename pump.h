@@ -0,0 +1,66 @@
+#ifndef PUMP_H
+#define PUMP_H
+
+#include <unistd.h>
+
+#include "uring.h"
+#include "deadline.h"
+#include "account.h"
+
+// engines that move the data of redirections
+typedef enum PumpEngine {
+    PE_SPLICE,
+    PE_URING
+} PumpEngine;
+
+// structure for input files concatenated into a pipe
+typedef struct InputFeed {
+    int *files;
+    int numFiles;
+    int currentFile;
+    int pipe;
+    int newlinePending;
+    char *buffer;
+    ssize_t bufferStart;
+    ssize_t bufferEnd;
+    // with the io_uring engine the next block is read into the second buffer while the first is written
+    IoRing *ring;
+    char *readAhead;
+    IoRingRequest readRequest;
+    int readPending;
+} InputFeed;
+
+// structure for a pipe copied into several files
+typedef struct OutputFanout {
+    int pipe;
+    int *files;
+    int numFiles;
+    int scratch[2];
+    ssize_t *copied;
+    char *buffer;
+    long long bytesWritten;
+    // with the io_uring engine every file gets its copy in one batch of writes
+    IoRing *ring;
+    IoRingRequest *requests;
+} OutputFanout;
+
+// structure for the data moved by the shell while a pipeline runs
+typedef struct Pump {
+    InputFeed input;
+    OutputFanout output;
+    OutputFanout error;
+    // the stages whose resources are measured, they are collected as soon as they exit
+    PipelineUsage *usage;
+} Pump;
+
+void initPumpEngine();
+void setPumpEngine(PumpEngine engine);
+PumpEngine getPumpEngine();
+
+void initPump(Pump *pump);
+int addInputFeed(Pump *pump, int *files, int numFiles);
+int addOutputFanout(OutputFanout *fanout, int *files, int numFiles);
+int isActivePump(Pump *pump);
+void runPump(Pump *pump, Deadline *deadline);
+
+#endif
\ No newline at end of file
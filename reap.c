@@ -0,0 +1,114 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#include "reap.h"
+#include "fanout.h"
+
+// SIGCHLD is blocked and read from this descriptor, so children are only collected
+// at the points the shell chooses instead of inside a signal handler
+int childSignalFd = -1;
+BackgroundList *reapedList = NULL;
+// set while a foreground pipeline runs, its stages are waited for by the pipeline
+int reaperPaused = 0;
+
+// start receiving SIGCHLD through a signalfd
+void initChildReaper(BackgroundList *list) {
+    reapedList = list;
+    sigset_t childSignal;
+    sigemptyset(&childSignal);
+    sigaddset(&childSignal, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &childSignal, NULL);
+    childSignalFd = signalfd(-1, &childSignal, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+// collect the background processes that finished
+void reapChildren() {
+    if (childSignalFd < 0 || reaperPaused) {
+        return;
+    }
+    // several exits can share one signal, so the signals only tell that waiting is needed
+    struct signalfd_siginfo info[16];
+    ssize_t len;
+    int signalled = 0;
+    while ((len = read(childSignalFd, info, sizeof(info))) > 0) {
+        signalled = 1;
+    }
+    if (!signalled) {
+        return;
+    }
+    pid_t pid;
+    int status;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        removeBackgroundProcessByPID(reapedList, pid, status);
+        // a finished fan-out worker frees its slot for the next item
+        collectFanoutWorker(pid, status);
+    }
+}
+
+// check if children are collected here, a subshell of the shell has none of the jobs as its children
+int canReapChildren() {
+    return childSignalFd >= 0;
+}
+
+// stop or continue collecting children
+void pauseChildReaper(int paused) {
+    reaperPaused = paused;
+}
+
+// wait until the descriptor can be read, collecting background processes in the meantime
+int waitForInput(int fd) {
+    struct pollfd fds[2];
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = childSignalFd;
+    fds[1].events = POLLIN;
+    while (1) {
+        fds[0].revents = 0;
+        fds[1].revents = 0;
+        if (poll(fds, childSignalFd < 0 ? 1 : 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (fds[1].revents & POLLIN) {
+            reapChildren();
+        }
+        if (fds[0].revents != 0) {
+            return 0;
+        }
+    }
+}
+
+// wait up to timeout milliseconds, or without a limit if it is -1, for a child to finish and collect it
+// returns 0 when the time ran out and -1 if the wait was interrupted
+int waitForChildren(int timeout) {
+    if (childSignalFd < 0) {
+        errno = ECHILD;
+        return -1;
+    }
+    struct pollfd fds[1];
+    fds[0].fd = childSignalFd;
+    fds[0].events = POLLIN;
+    int ready = poll(fds, 1, timeout);
+    if (ready < 0) {
+        return -1;
+    }
+    reapChildren();
+    return ready;
+}
+
+// stop receiving SIGCHLD through the signalfd
+void finalizeChildReaper() {
+    if (childSignalFd >= 0) {
+        close(childSignalFd);
+        childSignalFd = -1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef REAP_H
+#define REAP_H
+
+#include "list.h"
+
+void initChildReaper(BackgroundList *list);
+void reapChildren();
+int canReapChildren();
+void pauseChildReaper(int paused);
+int waitForInput(int fd);
+int waitForChildren(int timeout);
+void finalizeChildReaper();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,596 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "scriptcache.h"
+#include "usage.h"
+#include "utility.h"
+#include "arena.h"
+#include "parallel.h"
+
+// the version of the cache format, older files are compiled again
+#define SCRIPT_CACHE_VERSION 6
+// the start of every hash
+#define HASH_START 14695981039346656037ULL
+
+extern Arena *parseArena;
+extern ActiveOperator activeOperator;
+extern ActiveOperator futureOperator;
+extern int yyparse();
+extern void restartLexer();
+
+// whether the parser only records the chains instead of running them
+int compilingScript = 0;
+int compileErrors = 0;
+// the recorded chains and their strings
+ScriptBuffer records;
+ScriptBuffer strings;
+// the offsets of the recorded strings by hash, so every string is stored once
+unsigned int *stringSlots = NULL;
+unsigned int numStringSlots = 0;
+unsigned int numStrings = 0;
+
+// check if a script is being compiled
+int isCompilingScript() {
+    return compilingScript;
+}
+
+// remember that the script cannot be compiled
+void reportCompileError() {
+    compileErrors++;
+}
+
+// hash bytes with FNV-1a, continuing from an earlier hash
+unsigned long long hashBytes(unsigned long long hash, const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ (unsigned char) data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// append data to a buffer
+void appendScriptBuffer(ScriptBuffer *buffer, const void *data, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        buffer->capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+        while (buffer->size + size > buffer->capacity) {
+            buffer->capacity *= 2;
+        }
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+// free a buffer
+void freeScriptBuffer(ScriptBuffer *buffer) {
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
+
+// record a number
+void putWord(unsigned int word) {
+    appendScriptBuffer(&records, &word, sizeof(unsigned int));
+}
+
+// find the slot of a string, it is empty if the string was not recorded yet
+unsigned int *findStringSlot(char *string, size_t len) {
+    unsigned int index = hashBytes(HASH_START, string, len) & (numStringSlots - 1);
+    while (stringSlots[index] != 0 && strcmp(strings.data + stringSlots[index] - 1, string) != 0) {
+        index = (index + 1) & (numStringSlots - 1);
+    }
+    return &stringSlots[index];
+}
+
+// record a string
+void putString(char *string) {
+    if (numStrings * 2 >= numStringSlots) {
+        unsigned int *oldSlots = stringSlots;
+        unsigned int numOldSlots = numStringSlots;
+        numStringSlots = numStringSlots == 0 ? 256 : numStringSlots * 2;
+        stringSlots = calloc(numStringSlots, sizeof(unsigned int));
+        for (unsigned int i = 0; i < numOldSlots; i++) {
+            if (oldSlots[i] != 0) {
+                char *recorded = strings.data + oldSlots[i] - 1;
+                *findStringSlot(recorded, strlen(recorded)) = oldSlots[i];
+            }
+        }
+        free(oldSlots);
+    }
+    size_t len = strlen(string);
+    unsigned int *slot = findStringSlot(string, len);
+    if (*slot == 0) {
+        *slot = strings.size + 1;
+        appendScriptBuffer(&strings, string, len + 1);
+        numStrings++;
+    }
+    putWord(*slot - 1);
+}
+
+// record a command
+void putCommand(Command *command) {
+    putWord(command->builtInCommand);
+    putWord(command->commandArgs->numArgs);
+    for (int i = 0; i < command->commandArgs->numArgs; i++) {
+        putString(command->commandArgs->args[i]);
+    }
+}
+
+// record a file list
+void putFileList(FileList *fileList) {
+    putWord(fileList->numFiles);
+    for (int i = 0; i < fileList->numFiles; i++) {
+        putString(fileList->files[i]);
+    }
+}
+
+// record the operators and the input offset a record runs with
+void putRecordStart(ActiveOperator activeOperator, ActiveOperator futureOperator, off_t offset) {
+    putWord(activeOperator);
+    putWord(futureOperator);
+    putWord((unsigned long long) offset & 0xffffffff);
+    putWord((unsigned long long) offset >> 32);
+}
+
+void putChain(Chain *chain);
+
+// record the chains of a list with their operators and whether they run in the background
+void putChainSequence(ChainList *chainList) {
+    putWord(chainList->numChains);
+    for (int i = 0; i < chainList->numChains; i++) {
+        putWord(chainList->operators[i]);
+        putWord(chainList->chains[i]->background);
+        putChain(chainList->chains[i]);
+    }
+}
+
+// record a loop, the body is recorded once like it was parsed once
+void putLoop(Loop *loop) {
+    putWord(loop->type);
+    if (loop->type == LT_FOR) {
+        putString(loop->variable);
+        putFileList(loop->words);
+    } else {
+        putChainSequence(loop->condition);
+    }
+    putChainSequence(loop->body);
+}
+
+// record the parts of a chain
+void putChain(Chain *chain) {
+    if (chain->BuiltInCommand != NULL) {
+        putWord(1);
+        putCommand(chain->BuiltInCommand);
+        return;
+    }
+    if (chain->loop != NULL) {
+        putWord(3);
+        putLoop(chain->loop);
+        return;
+    }
+    putWord(0);
+    putWord(chain->timed);
+    putWord((unsigned long long) chain->timeout & 0xffffffff);
+    putWord((unsigned long long) chain->timeout >> 32);
+    putWord(chain->timeoutSignal);
+    Pipeline *pipeline = chain->pipelineRedirections->pipeline;
+    putWord(pipeline->numCommands);
+    for (int i = 0; i < pipeline->numCommands; i++) {
+        putCommand(pipeline->commands[i]);
+    }
+    putFileList(chain->pipelineRedirections->redirections->inputFiles);
+    putFileList(chain->pipelineRedirections->redirections->outputFiles);
+    putFileList(chain->pipelineRedirections->redirections->errorFiles);
+}
+
+// record a chain with the operators and the input offset it runs with
+void recordChain(Chain *chain, ActiveOperator activeOperator, ActiveOperator futureOperator, off_t offset) {
+    putRecordStart(activeOperator, futureOperator, offset);
+    putChain(chain);
+}
+
+// record a parallel block with the operators and the input offset it runs with
+void recordChainList(ChainList *chainList, ActiveOperator activeOperator, ActiveOperator futureOperator, off_t offset) {
+    putRecordStart(activeOperator, futureOperator, offset);
+    putWord(2);
+    putWord(chainList->limit);
+    putChainSequence(chainList);
+}
+
+// read a number
+unsigned int readWord(ScriptReader *reader) {
+    if (!reader->valid || reader->position + sizeof(unsigned int) > reader->size) {
+        reader->valid = 0;
+        return 0;
+    }
+    unsigned int word;
+    memcpy(&word, reader->data + reader->position, sizeof(unsigned int));
+    reader->position += sizeof(unsigned int);
+    return word;
+}
+
+// read a count, which cannot be larger than the data left
+unsigned int readCount(ScriptReader *reader) {
+    unsigned int count = readWord(reader);
+    if (count > (reader->size - reader->position) / sizeof(unsigned int)) {
+        reader->valid = 0;
+        return 0;
+    }
+    return count;
+}
+
+// read a string, it points into the cache
+char *readString(ScriptReader *reader) {
+    unsigned int offset = readWord(reader);
+    if (!reader->valid || offset >= reader->stringsSize) {
+        reader->valid = 0;
+        return "";
+    }
+    return reader->strings + offset;
+}
+
+// read a command
+Command *readCommand(ScriptReader *reader) {
+    BuiltInCommand builtInCommand = readWord(reader);
+    unsigned int numArgs = readCount(reader);
+    Args *args = createArgs();
+    // utilities are recorded like other commands, with their name as the first argument
+    if (builtInCommand != BIC_NONE && !isUtility(builtInCommand)) {
+        for (unsigned int i = 0; i < numArgs; i++) {
+            addArg(args, readString(reader));
+        }
+        return createBuiltInCommand(builtInCommand, args);
+    }
+    if (numArgs == 0) {
+        reader->valid = 0;
+        return NULL;
+    }
+    char *commandName = readString(reader);
+    for (unsigned int i = 1; i < numArgs; i++) {
+        addArg(args, readString(reader));
+    }
+    return createCommand(commandName, args);
+}
+
+// read the files of a redirection
+void readFileList(ScriptReader *reader, Redirections *redirections, RedirectionType type) {
+    unsigned int numFiles = readCount(reader);
+    for (unsigned int i = 0; i < numFiles && reader->valid; i++) {
+        if (addRedirection(redirections, readString(reader), type) == NULL) {
+            reader->valid = 0;
+        }
+    }
+}
+
+ChainList *readChainSequence(ScriptReader *reader);
+
+// read a loop
+Loop *readLoop(ScriptReader *reader) {
+    LoopType type = readWord(reader);
+    if (type == LT_FOR) {
+        char *variable = readString(reader);
+        FileList *words = createFileList();
+        unsigned int numWords = readCount(reader);
+        for (unsigned int i = 0; i < numWords && reader->valid; i++) {
+            addFile(words, readString(reader));
+        }
+        return createForLoop(variable, words, readChainSequence(reader));
+    }
+    if (type != LT_WHILE) {
+        reader->valid = 0;
+        return NULL;
+    }
+    ChainList *condition = readChainSequence(reader);
+    return createWhileLoop(condition, readChainSequence(reader));
+}
+
+// read a chain of the given kind
+Chain *readChainParts(ScriptReader *reader, unsigned int kind) {
+    if (kind == 1) {
+        return createChain(NULL, readCommand(reader));
+    }
+    if (kind == 3) {
+        return createLoopChain(readLoop(reader));
+    }
+    int timed = readWord(reader);
+    unsigned long long timeout = readWord(reader);
+    timeout |= (unsigned long long) readWord(reader) << 32;
+    int timeoutSignal = readWord(reader);
+    unsigned int numCommands = readCount(reader);
+    if (numCommands == 0) {
+        reader->valid = 0;
+        return NULL;
+    }
+    Pipeline *pipeline = createPipeline(readCommand(reader));
+    for (unsigned int i = 1; i < numCommands && reader->valid; i++) {
+        addCommandToPipeline(pipeline, readCommand(reader));
+    }
+    Redirections *redirections = createRedirections();
+    readFileList(reader, redirections, R_INPUT);
+    readFileList(reader, redirections, R_OUTPUT);
+    readFileList(reader, redirections, R_ERROR);
+    Chain *chain = createChain(createPipelineRedirections(pipeline, redirections), NULL);
+    chain->timed = timed;
+    chain->timeout = (long long) timeout;
+    chain->timeoutSignal = timeoutSignal;
+    return chain;
+}
+
+// read a chain
+Chain *readChain(ScriptReader *reader) {
+    return readChainParts(reader, readWord(reader));
+}
+
+// read chains with their operators and whether they run in the background
+ChainList *readChainSequence(ScriptReader *reader) {
+    ChainList *chainList = createChainList();
+    unsigned int numChains = readCount(reader);
+    for (unsigned int i = 0; i < numChains && reader->valid; i++) {
+        ActiveOperator operator = readWord(reader);
+        int background = readWord(reader);
+        Chain *chain = readChain(reader);
+        if (chain != NULL) {
+            chain->background = background;
+        }
+        addChainToList(chainList, chain, operator);
+    }
+    return chainList;
+}
+
+// read the chains of a parallel block
+ChainList *readChainList(ScriptReader *reader) {
+    int limit = readWord(reader);
+    ChainList *chainList = readChainSequence(reader);
+    chainList->limit = limit;
+    return chainList;
+}
+
+// create a reader for the records and strings
+ScriptReader createScriptReader(char *recordsData, size_t recordsSize, char *stringsData, size_t stringsSize) {
+    ScriptReader reader;
+    reader.data = recordsData;
+    reader.size = recordsSize;
+    reader.position = 0;
+    reader.strings = stringsData;
+    reader.stringsSize = stringsSize;
+    // every string has to end inside the cache
+    reader.valid = stringsSize == 0 || stringsData[stringsSize - 1] == '\0';
+    return reader;
+}
+
+// check that every record can be read before anything runs
+int validateScriptRecords(ScriptReader reader) {
+    while (reader.valid && reader.position < reader.size) {
+        for (int i = 0; i < 4; i++) {
+            readWord(&reader);
+        }
+        unsigned int kind = readWord(&reader);
+        if (kind == 2) {
+            readChainList(&reader);
+        } else {
+            readChainParts(&reader, kind);
+        }
+        resetArena(parseArena);
+    }
+    return reader.valid;
+}
+
+// run the recorded chains, the rest of the script is parsed if a command reads from it; the chains after
+// it on the same line still run, like the lexer still has them when it reads the script itself
+void replayScript(ScriptReader reader) {
+    // the line whose commands read the script and how far they read, -1 while nothing was read
+    off_t readLine = -1;
+    off_t readPosition = -1;
+    while (reader.position < reader.size) {
+        ActiveOperator recordedActive = readWord(&reader);
+        ActiveOperator recordedFuture = readWord(&reader);
+        off_t offset = readWord(&reader);
+        offset |= (off_t) readWord(&reader) << 32;
+        if (readLine != -1 && offset != readLine) {
+            break;
+        }
+        // commands on the line of a command that read the script continue where it stopped
+        off_t position = readLine != -1 ? readPosition : offset;
+        unsigned int kind = readWord(&reader);
+        if (kind == 2) {
+            // the chains of a parallel block do not read the script
+            activeOperator = recordedActive;
+            futureOperator = recordedFuture;
+            runParallel(readChainList(&reader));
+            activeOperator = futureOperator;
+            resetArena(parseArena);
+            continue;
+        }
+        Chain *chain = readChainParts(&reader, kind);
+
+        // the commands see the script input where the parser would be, most built-ins do not read it
+        int readsInput = chain->BuiltInCommand == NULL || chainReadsInput(chain);
+        if (readsInput) {
+            lseek(STDIN_FILENO, position, SEEK_SET);
+        }
+        activeOperator = recordedActive;
+        futureOperator = recordedFuture;
+        runChain(chain);
+        activeOperator = futureOperator;
+        resetArena(parseArena);
+
+        if (readsInput && lseek(STDIN_FILENO, 0, SEEK_CUR) != position) {
+            readLine = offset;
+            readPosition = lseek(STDIN_FILENO, 0, SEEK_CUR);
+        }
+    }
+    if (readLine != -1) {
+        lseek(STDIN_FILENO, readPosition, SEEK_SET);
+        restartLexer();
+        yyparse();
+    }
+}
+
+// fill in the header that describes the script, the contents are hashed later if needed
+void fillScriptCacheHeader(ScriptCacheHeader *header, struct stat *info) {
+    memset(header, 0, sizeof(ScriptCacheHeader));
+    memcpy(header->magic, "SHC1", 4);
+    header->version = SCRIPT_CACHE_VERSION;
+    header->device = info->st_dev;
+    header->inode = info->st_ino;
+    header->size = info->st_size;
+    header->mtimeSeconds = info->st_mtim.tv_sec;
+    header->mtimeNanoseconds = info->st_mtim.tv_nsec;
+}
+
+// get the path of the cache file of a script, or NULL if caching is disabled
+char *getScriptCachePath(char *scriptPath) {
+    char *directory = getenv("SHELL_SCRIPT_CACHE");
+    if (directory == NULL || directory[0] == '\0') {
+        return NULL;
+    }
+    char *resolved = realpath(scriptPath, NULL);
+    if (resolved == NULL) {
+        return NULL;
+    }
+    unsigned long long hash = hashBytes(HASH_START, resolved, strlen(resolved));
+    free(resolved);
+    size_t len = strlen(directory) + 32;
+    char *path = malloc(len);
+    snprintf(path, len, "%s/%016llx.shc", directory, hash);
+    return path;
+}
+
+// hash the contents of the script into the header, returns 0 if the script could not be read
+int hashScript(ScriptCacheHeader *header, struct stat *info) {
+    if (info->st_size == 0) {
+        header->contentHash = HASH_START;
+        return 1;
+    }
+    char *contents = mmap(NULL, info->st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+    if (contents == MAP_FAILED) {
+        return 0;
+    }
+    header->contentHash = hashBytes(HASH_START, contents, info->st_size);
+    munmap(contents, info->st_size);
+    return 1;
+}
+
+// check if a cache file was made from the script; the script is only hashed when its size and
+// modification time do not match, a script that was touched but not changed is still used
+int matchesScript(ScriptCacheHeader *header, ScriptCacheHeader *expected, struct stat *script, int *hashed) {
+    if (memcmp(header, expected, offsetof(ScriptCacheHeader, contentHash)) == 0) {
+        return 1;
+    }
+    if (memcmp(header, expected, offsetof(ScriptCacheHeader, mtimeSeconds)) != 0) {
+        return 0;
+    }
+    *hashed = hashScript(expected, script);
+    return *hashed && header->contentHash == expected->contentHash;
+}
+
+// run the script from its cache file, returns 0 if it does not match the script
+int runScriptCacheFile(char *cachePath, ScriptCacheHeader *expected, struct stat *script, int *hashed) {
+    int file = open(cachePath, O_RDONLY | O_CLOEXEC);
+    if (file < 0) {
+        return 0;
+    }
+    struct stat info;
+    if (fstat(file, &info) < 0 || (size_t) info.st_size < sizeof(ScriptCacheHeader)) {
+        close(file);
+        return 0;
+    }
+    char *cache = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (cache == MAP_FAILED) {
+        return 0;
+    }
+    ScriptCacheHeader *header = (ScriptCacheHeader *) cache;
+    int matches = matchesScript(header, expected, script, hashed)
+        && sizeof(ScriptCacheHeader) + header->recordsSize + header->stringsSize == (unsigned long long) info.st_size
+        && hashBytes(HASH_START, cache + sizeof(ScriptCacheHeader), info.st_size - sizeof(ScriptCacheHeader)) == header->recordsHash;
+    char *recordsData = cache + sizeof(ScriptCacheHeader);
+    ScriptReader reader = createScriptReader(recordsData, matches ? header->recordsSize : 0,
+        recordsData + (matches ? header->recordsSize : 0), matches ? header->stringsSize : 0);
+    if (!matches || !validateScriptRecords(reader)) {
+        munmap(cache, info.st_size);
+        return 0;
+    }
+    replayScript(reader);
+    munmap(cache, info.st_size);
+    return 1;
+}
+
+// write the recorded chains to the cache file
+void writeScriptCacheFile(char *cachePath, ScriptCacheHeader *header) {
+    header->recordsSize = records.size;
+    header->stringsSize = strings.size;
+    header->recordsHash = hashBytes(hashBytes(HASH_START, records.data, records.size), strings.data, strings.size);
+    size_t len = strlen(cachePath) + 32;
+    char *temporaryPath = malloc(len);
+    snprintf(temporaryPath, len, "%s.%d", cachePath, (int) getpid());
+    int file = open(temporaryPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (file >= 0) {
+        int written = write(file, header, sizeof(ScriptCacheHeader)) == sizeof(ScriptCacheHeader)
+            && write(file, records.data, records.size) == (ssize_t) records.size
+            && write(file, strings.data, strings.size) == (ssize_t) strings.size;
+        close(file);
+        // other shells only ever see a complete file
+        if (!written || rename(temporaryPath, cachePath) < 0) {
+            unlink(temporaryPath);
+        }
+    }
+    free(temporaryPath);
+}
+
+// parse the whole script without running it, returns 0 if it has syntax errors
+int compileScript() {
+    compilingScript = 1;
+    compileErrors = 0;
+    yyparse();
+    compilingScript = 0;
+    resetArena(parseArena);
+
+    // start again from the beginning of the script
+    lseek(STDIN_FILENO, 0, SEEK_SET);
+    restartLexer();
+    activeOperator = AO_NONE;
+    futureOperator = AO_NEWLINE;
+    return compileErrors == 0;
+}
+
+// run the script on stdin from its compiled form, returns 0 if it has to be parsed normally
+int runCachedScript(char *scriptPath) {
+    char *cachePath = getScriptCachePath(scriptPath);
+    struct stat info;
+    if (cachePath == NULL || fstat(STDIN_FILENO, &info) < 0 || !S_ISREG(info.st_mode)) {
+        free(cachePath);
+        return 0;
+    }
+    ScriptCacheHeader header;
+    fillScriptCacheHeader(&header, &info);
+    int hashed = 0;
+
+    if (runScriptCacheFile(cachePath, &header, &info, &hashed)) {
+        free(cachePath);
+        return 1;
+    }
+
+    // compile the script, keep it for the next run and run it
+    int compiled = compileScript();
+    if (compiled) {
+        // a script that cannot be hashed is run without a cache, a made up hash would match later
+        if (hashed || hashScript(&header, &info)) {
+            writeScriptCacheFile(cachePath, &header);
+        }
+        ScriptReader reader = createScriptReader(records.data, records.size, strings.data, strings.size);
+        replayScript(reader);
+    }
+    freeScriptBuffer(&records);
+    freeScriptBuffer(&strings);
+    free(stringSlots);
+    free(cachePath);
+    return compiled;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef SCRIPTCACHE_H
+#define SCRIPTCACHE_H
+
+#include <sys/types.h>
+
+#include "structs.h"
+
+// structure for growing binary data
+typedef struct ScriptBuffer {
+    char *data;
+    size_t size;
+    size_t capacity;
+} ScriptBuffer;
+
+// structure for reading binary data
+typedef struct ScriptReader {
+    char *data;
+    size_t size;
+    size_t position;
+    char *strings;
+    size_t stringsSize;
+    int valid;
+} ScriptReader;
+
+// structure for the start of a cache file
+typedef struct ScriptCacheHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned long long device;
+    unsigned long long inode;
+    unsigned long long size;
+    long long mtimeSeconds;
+    long long mtimeNanoseconds;
+    unsigned long long contentHash;
+    unsigned long long recordsSize;
+    unsigned long long stringsSize;
+    unsigned long long recordsHash;
+} ScriptCacheHeader;
+
+int isCompilingScript();
+void reportCompileError();
+void recordChain(Chain *chain, ActiveOperator activeOperator, ActiveOperator futureOperator, off_t offset);
+void recordChainList(ChainList *chainList, ActiveOperator activeOperator, ActiveOperator futureOperator, off_t offset);
+int runCachedScript(char *scriptPath);
+
+#endif
\ No newline at end of file
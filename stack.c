@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "stack.h"
 
@@ -8,27 +10,43 @@ Stack *createStack() {
     Stack *stack = malloc(sizeof(Stack));
     stack->size = 0;
     stack->capacity = 1;
-    stack->data = malloc(sizeof(void *));
+    stack->entries = malloc(sizeof(StackEntry));
+    stack->pathsLength = 0;
+    stack->pathsCapacity = 256;
+    stack->paths = malloc(stack->pathsCapacity);
     return stack;
 }
 
-// push an element to the stack
-void pushStack(Stack *stack, void *element) {
+// push a directory to the stack, the stack takes over the descriptor
+void pushStack(Stack *stack, int fd, char *path, int pathLength) {
     if (stack->size == stack->capacity) {
         stack->capacity *= 2;
-        stack->data = realloc(stack->data, stack->capacity * sizeof(void *));
+        stack->entries = realloc(stack->entries, stack->capacity * sizeof(StackEntry));
     }
-    stack->data[stack->size] = element;
+    while (stack->pathsLength + pathLength + 1 > stack->pathsCapacity) {
+        stack->pathsCapacity *= 2;
+        stack->paths = realloc(stack->paths, stack->pathsCapacity);
+    }
+    StackEntry *entry = &stack->entries[stack->size];
+    entry->fd = fd;
+    entry->pathOffset = stack->pathsLength;
+    memcpy(stack->paths + stack->pathsLength, path, pathLength);
+    stack->paths[stack->pathsLength + pathLength] = '\0';
+    stack->pathsLength += pathLength + 1;
     stack->size++;
 }
 
-// pop an element from the stack
-void *popStack(Stack *stack) {
+// pop a directory from the stack, returns its descriptor or -1 if the stack is empty
+// the path stays valid until the next push
+int popStack(Stack *stack, char **path) {
     if (isEmptyStack(stack)) {
-        return NULL;
+        return -1;
     }
     stack->size--;
-    return stack->data[stack->size];
+    StackEntry *entry = &stack->entries[stack->size];
+    *path = stack->paths + entry->pathOffset;
+    stack->pathsLength = entry->pathOffset;
+    return entry->fd;
 }
 
 // check if the stack is empty
@@ -39,8 +57,9 @@ int isEmptyStack(Stack *stack) {
 // free the stack
 void freeStack(Stack *stack) {
     for (int i = 0; i < stack->size; i++) {
-        free(stack->data[i]);
+        close(stack->entries[i].fd);
     }
-    free(stack->data);
+    free(stack->entries);
+    free(stack->paths);
     free(stack);
 }
\ No newline at end of file
@@ -1,16 +1,27 @@
 #ifndef STACK_H
 #define STACK_H
 
-// structure for stack
+// structure for a directory on the stack, its path is kept in the path storage of the stack
+typedef struct StackEntry {
+    // an O_PATH descriptor of the directory, so it can be entered without resolving the path
+    int fd;
+    int pathOffset;
+} StackEntry;
+
+// structure for the directory stack
 typedef struct Stack {
-    void **data;
+    StackEntry *entries;
     int size;
     int capacity;
+    // the paths of the entries one after another, each one ends with a null byte
+    char *paths;
+    int pathsLength;
+    int pathsCapacity;
 } Stack;
 
 Stack *createStack();
-void pushStack(Stack *stack, void *data);
-void *popStack(Stack *stack);
+void pushStack(Stack *stack, int fd, char *path, int pathLength);
+int popStack(Stack *stack, char **path);
 int isEmptyStack(Stack *stack);
 void freeStack(Stack *stack);
 
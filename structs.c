@@ -1,118 +1,102 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <signal.h>
 
 #include "structs.h"
+#include "arena.h"
+#include "deadline.h"
+#include "utility.h"
 
-extern Chain *lastChain;
-extern Pipeline *lastPipeline;
-extern Redirections *lastRedirections;
-extern Command *lastCommand;
-extern Args *lastArgs;
+// every node of the parse tree lives in this arena until the input line is finished
+extern Arena *parseArena;
+
+// names of the built-in commands, in the order of BuiltInCommand
+char *builtInCommandNames[] = { NULL, "exit", "status", "cd", "pushd", "popd", "kill", "jobs", "hash", "pipesize", "fanout", "wait", "echo", "true", "false", "test", "printf" };
+
+// make room for one more pointer, the capacity grows geometrically
+void **growArray(void **array, int *capacity, int needed) {
+    if (needed <= *capacity) {
+        return array;
+    }
+    int newCapacity = *capacity * 2;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    void **grown = arenaAlloc(parseArena, newCapacity * sizeof(void *));
+    memcpy(grown, array, *capacity * sizeof(void *));
+    *capacity = newCapacity;
+    return grown;
+}
 
 // create an empty list of arguments
 Args *createArgs() {
-    Args *args = malloc(sizeof(Args));
-    args->args = malloc(sizeof(char *));
+    Args *args = arenaAlloc(parseArena, sizeof(Args));
+    args->capacity = 4;
+    args->args = arenaAlloc(parseArena, args->capacity * sizeof(char *));
     args->args[0] = NULL; // Space for the command name
     args->numArgs = 1;
-    // remember the last arguments
-    lastArgs = args;
     return args;
 }
 
 // add an argument to the list of arguments
 Args *addArg(Args *args, char *arg) {
-    args->args = realloc(args->args, (args->numArgs + 1) * sizeof(char *));
+    // keep room for the terminating NULL
+    args->args = (char **) growArray((void **) args->args, &args->capacity, args->numArgs + 2);
     args->args[args->numArgs] = arg;
     args->numArgs++;
     return args;
 }
 
-// free the list of arguments
-void freeArgs(Args *args) {
-    for (int i = 0; i < args->numArgs; i++) {
-        free(args->args[i]);
-    }
-    free(args->args);
-    free(args);
-}
-
-// create a command
+// create a command, the utilities the shell runs itself are found by their name
 Command *createCommand(char *commandName, Args *commandArgs) {
-    Command *command = malloc(sizeof(Command));
+    Command *command = arenaAlloc(parseArena, sizeof(Command));
     command->commandName = commandName;
     command->commandArgs = commandArgs;
     command->commandArgs->args[0] = commandName;                        // Set the first argument to the command name
-    command->commandArgs->args = realloc(command->commandArgs->args, (command->commandArgs->numArgs + 1) * sizeof(char *));
     command->commandArgs->args[command->commandArgs->numArgs] = NULL;   // Null-terminate the array of arguments
-    command->builtInCommand = BIC_NONE;
-    // remember the last command
-    lastCommand = command;
-    // forget the unnecessary data
-    lastArgs = NULL;
+    command->builtInCommand = findUtility(commandName);
     return command;
 }
 
 // create a built-in command
 Command *createBuiltInCommand(BuiltInCommand builtInCommand, Args *commandArgs) {
-    Command *command = malloc(sizeof(Command));
+    Command *command = arenaAlloc(parseArena, sizeof(Command));
     command->commandName = NULL;
     for (int i = 0; i < commandArgs->numArgs - 1; i++) {
         commandArgs->args[i] = commandArgs->args[i + 1];
     }
     commandArgs->numArgs--;
     commandArgs->args[commandArgs->numArgs] = NULL;
-    commandArgs->args = realloc(commandArgs->args, commandArgs->numArgs * sizeof(char *));
     command->commandArgs = commandArgs;
     command->builtInCommand = builtInCommand;
-    // forget the unnecessary data
-    lastArgs = NULL;
     return command;
 }
 
-// free a command
-void freeCommand(Command *command) {
-    // the name is freed when the args are freed
-    freeArgs(command->commandArgs);
-    free(command);
-}
-
 // create a pipeline
 Pipeline *createPipeline(Command *command) {
-    Pipeline *pipeline = malloc(sizeof(Pipeline));
-    pipeline->commands = malloc(sizeof(Command *));
+    Pipeline *pipeline = arenaAlloc(parseArena, sizeof(Pipeline));
+    pipeline->capacity = 2;
+    pipeline->commands = arenaAlloc(parseArena, pipeline->capacity * sizeof(Command *));
     pipeline->commands[0] = command;
     pipeline->numCommands = 1;
-    // remember the last pipeline
-    lastPipeline = pipeline;
-    // forget the unnecessary data
-    lastCommand = NULL;
     return pipeline;
 }
 
 // add a command to a pipeline
 Pipeline *addCommandToPipeline(Pipeline *pipeline, Command *command) {
-    pipeline->commands = realloc(pipeline->commands, (pipeline->numCommands + 1) * sizeof(Command *));
+    pipeline->commands = (Command **) growArray((void **) pipeline->commands, &pipeline->capacity, pipeline->numCommands + 1);
     pipeline->commands[pipeline->numCommands] = command;
     pipeline->numCommands++;
-    // forget the unnecessary data
-    lastCommand = NULL;
     return pipeline;
 }
 
-// free a pipeline
-void freePipeline(Pipeline *pipeline) {
-    for (int i = 0; i < pipeline->numCommands; i++) {
-        freeCommand(pipeline->commands[i]);
-    }
-    free(pipeline->commands);
-    free(pipeline);
-}
-
 // create a file list
 FileList *createFileList() {
-    FileList *fileList = malloc(sizeof(FileList));
-    fileList->files = malloc(sizeof(char *));
+    FileList *fileList = arenaAlloc(parseArena, sizeof(FileList));
+    fileList->capacity = 2;
+    fileList->files = arenaAlloc(parseArena, fileList->capacity * sizeof(char *));
     fileList->files[0] = NULL;
     fileList->numFiles = 0;
     return fileList;
@@ -120,29 +104,20 @@ FileList *createFileList() {
 
 // add a file to a file list
 FileList *addFile(FileList *fileList, char *file) {
-    fileList->files = realloc(fileList->files, (fileList->numFiles + 1) * sizeof(char *));
+    // keep room for the terminating NULL
+    fileList->files = (char **) growArray((void **) fileList->files, &fileList->capacity, fileList->numFiles + 2);
     fileList->files[fileList->numFiles] = file;
     fileList->numFiles++;
+    fileList->files[fileList->numFiles] = NULL;
     return fileList;
 }
 
-// free a file list
-void freeFileList(FileList *fileList) {
-    for (int i = 0; i < fileList->numFiles; i++) {
-        free(fileList->files[i]);
-    }
-    free(fileList->files);
-    free(fileList);
-}
-
 // create redirections
 Redirections *createRedirections() {
-    Redirections *redirections = malloc(sizeof(Redirections));
+    Redirections *redirections = arenaAlloc(parseArena, sizeof(Redirections));
     redirections->inputFiles = createFileList();
     redirections->outputFiles = createFileList();
     redirections->errorFiles = createFileList();
-    // remember the last redirections
-    lastRedirections = redirections;
     return redirections;
 }
 
@@ -172,49 +147,241 @@ Redirections *addRedirection(Redirections *redirections, char *file, Redirection
     return redirections;
 }
 
-// free redirections
-void freeRedirections(Redirections *redirections) {
-    freeFileList(redirections->inputFiles);
-    freeFileList(redirections->outputFiles);
-    freeFileList(redirections->errorFiles);
-    free(redirections);
-}
-
 // create a pipeline redirections
 PipelineRedirections *createPipelineRedirections(Pipeline *pipeline, Redirections *redirections) {
-    PipelineRedirections *pipelineRedirections = malloc(sizeof(PipelineRedirections));
+    PipelineRedirections *pipelineRedirections = arenaAlloc(parseArena, sizeof(PipelineRedirections));
     pipelineRedirections->pipeline = pipeline;
     pipelineRedirections->redirections = redirections;
-    // forget the unnecessary data
-    lastPipeline = NULL;
-    lastRedirections = NULL;
     return pipelineRedirections;
 }
 
-// free a pipeline redirections
-void freePipelineRedirections(PipelineRedirections *pipelineRedirections) {
-    freeRedirections(pipelineRedirections->redirections);
-    freePipeline(pipelineRedirections->pipeline);
-    free(pipelineRedirections);
-}
-
 // create a chain
 Chain *createChain(PipelineRedirections *pipelineRedirections, Command *BuiltInCommand) {
-    Chain *chain = malloc(sizeof(Chain));
+    Chain *chain = arenaAlloc(parseArena, sizeof(Chain));
     chain->pipelineRedirections = pipelineRedirections;
     chain->BuiltInCommand = BuiltInCommand;
-    // remember the last chain
-    lastChain = chain;
+    chain->loop = NULL;
+    chain->timed = 0;
+    chain->timeout = 0;
+    chain->timeoutSignal = SIGTERM;
+    chain->background = 0;
+    return chain;
+}
+
+// create a chain for a pipeline, a single built-in command without redirections runs on its own;
+// utilities stay pipelines, as the program runs when the shell cannot give the same result
+Chain *createPipelineChain(Pipeline *pipeline, Redirections *redirections) {
+    Command *command = pipeline->commands[0];
+    if (pipeline->numCommands == 1 && command->builtInCommand != BIC_NONE && !isUtility(command->builtInCommand)
+        && redirections->inputFiles->numFiles == 0 && redirections->outputFiles->numFiles == 0 && redirections->errorFiles->numFiles == 0) {
+        return createChain(NULL, command);
+    }
+    return createChain(createPipelineRedirections(pipeline, redirections), NULL);
+}
+
+// create a chain for a pipeline with a time limit, the first words of the first command are the
+// options of timeout: [-s signal] duration [-s signal] command args
+Chain *createTimeoutChain(Pipeline *pipeline, Redirections *redirections) {
+    Command *command = pipeline->commands[0];
+    long long timeout = -1;
+    int timeoutSignal = SIGTERM;
+    int i = 0;
+    while (command->builtInCommand == BIC_NONE && i < command->commandArgs->numArgs && timeoutSignal != -1) {
+        char *arg = command->commandArgs->args[i];
+        if (strcmp(arg, "-s") == 0) {
+            timeoutSignal = i + 1 < command->commandArgs->numArgs ? parseSignal(command->commandArgs->args[i + 1]) : -1;
+            i += 2;
+        } else if (timeout == -1) {
+            timeout = parseDuration(arg);
+            if (timeout == -1) {
+                break;
+            }
+            i++;
+        } else {
+            break;
+        }
+    }
+    // the words that are left are the command that runs with the limit
+    int valid = timeout != -1 && timeoutSignal != -1 && i < command->commandArgs->numArgs;
+    if (valid) {
+        Args *args = command->commandArgs;
+        for (int j = i; j <= args->numArgs; j++) {
+            args->args[j - i] = args->args[j];
+        }
+        args->numArgs -= i;
+        command->commandName = args->args[0];
+    }
+    Chain *chain = createChain(createPipelineRedirections(pipeline, redirections), NULL);
+    chain->timeout = valid ? timeout : -1;
+    chain->timeoutSignal = valid ? timeoutSignal : SIGTERM;
+    return chain;
+}
+
+// create a for loop, the variable takes each of the words in turn
+Loop *createForLoop(char *variable, FileList *words, ChainList *body) {
+    Loop *loop = arenaAlloc(parseArena, sizeof(Loop));
+    loop->type = LT_FOR;
+    loop->variable = variable;
+    loop->words = words;
+    loop->condition = NULL;
+    loop->body = body;
+    return loop;
+}
+
+// create a while loop
+Loop *createWhileLoop(ChainList *condition, ChainList *body) {
+    Loop *loop = arenaAlloc(parseArena, sizeof(Loop));
+    loop->type = LT_WHILE;
+    loop->variable = NULL;
+    loop->words = NULL;
+    loop->condition = condition;
+    loop->body = body;
+    return loop;
+}
+
+// create a chain for a loop
+Chain *createLoopChain(Loop *loop) {
+    Chain *chain = createChain(NULL, NULL);
+    chain->loop = loop;
     return chain;
 }
 
-// free a chain
-void freeChain(Chain *chain) {
-    if (chain->pipelineRedirections != NULL) {
-        freePipelineRedirections(chain->pipelineRedirections);
+// create an empty list of chains
+ChainList *createChainList() {
+    ChainList *chainList = arenaAlloc(parseArena, sizeof(ChainList));
+    chainList->capacity = 4;
+    chainList->chains = arenaAlloc(parseArena, chainList->capacity * sizeof(Chain *));
+    chainList->operators = arenaAlloc(parseArena, chainList->capacity * sizeof(ActiveOperator));
+    chainList->numChains = 0;
+    chainList->limit = 0;
+    return chainList;
+}
+
+// add a chain to a list of chains
+ChainList *addChainToList(ChainList *chainList, Chain *chain, ActiveOperator operator) {
+    if (chainList->numChains == chainList->capacity) {
+        int capacity = chainList->capacity;
+        ActiveOperator *operators = arenaAlloc(parseArena, capacity * 2 * sizeof(ActiveOperator));
+        memcpy(operators, chainList->operators, capacity * sizeof(ActiveOperator));
+        chainList->operators = operators;
+        chainList->chains = (Chain **) growArray((void **) chainList->chains, &chainList->capacity, chainList->numChains + 1);
+    }
+    chainList->chains[chainList->numChains] = chain;
+    chainList->operators[chainList->numChains] = operator;
+    chainList->numChains++;
+    return chainList;
+}
+
+// add the chains of another list to a list of chains
+ChainList *appendChainList(ChainList *chainList, ChainList *other) {
+    for (int i = 0; i < other->numChains; i++) {
+        addChainToList(chainList, other->chains[i], other->operators[i]);
+    }
+    return chainList;
+}
+
+// write a word, quoted if it would not be read back as one word
+void printWord(FILE *stream, char *word) {
+    if (word[0] == '\0' || strpbrk(word, " \t;|&<>") != NULL) {
+        fprintf(stream, "\"%s\"", word);
+    } else {
+        fprintf(stream, "%s", word);
+    }
+}
+
+// write the files of one type of redirection
+void printFileList(FILE *stream, char *operator, FileList *fileList) {
+    for (int i = 0; i < fileList->numFiles; i++) {
+        fprintf(stream, " %s ", operator);
+        printWord(stream, fileList->files[i]);
+    }
+}
+
+// write a command, built-in commands keep their name apart from the arguments
+void printCommand(FILE *stream, Command *command) {
+    Args *args = command->commandArgs;
+    if (command->commandName == NULL) {
+        fprintf(stream, "%s", builtInCommandNames[command->builtInCommand]);
     }
+    for (int i = 0; i < args->numArgs; i++) {
+        if (i > 0 || command->commandName == NULL) {
+            fprintf(stream, " ");
+        }
+        printWord(stream, args->args[i]);
+    }
+}
+
+void printChain(FILE *stream, Chain *chain);
+
+// write the chains of a list, separated by their operators
+void printChainList(FILE *stream, ChainList *chainList) {
+    for (int i = 0; i < chainList->numChains; i++) {
+        if (chainList->operators[i] == AO_AND_OPERATOR) {
+            fprintf(stream, " && ");
+        } else if (chainList->operators[i] == AO_OR_OPERATOR) {
+            fprintf(stream, " || ");
+        } else if (i > 0) {
+            fprintf(stream, chainList->chains[i - 1]->background ? " " : "; ");
+        }
+        printChain(stream, chainList->chains[i]);
+        if (chainList->chains[i]->background) {
+            fprintf(stream, " &");
+        }
+    }
+}
+
+// write a loop, its body on the same line
+void printLoop(FILE *stream, Loop *loop) {
+    if (loop->type == LT_FOR) {
+        fprintf(stream, "for %s in", loop->variable);
+        for (int i = 0; i < loop->words->numFiles; i++) {
+            fprintf(stream, " ");
+            printWord(stream, loop->words->files[i]);
+        }
+    } else {
+        fprintf(stream, "while ");
+        printChainList(stream, loop->condition);
+    }
+    fprintf(stream, "; do ");
+    printChainList(stream, loop->body);
+    fprintf(stream, "; done");
+}
+
+// write a chain
+void printChain(FILE *stream, Chain *chain) {
     if (chain->BuiltInCommand != NULL) {
-        freeCommand(chain->BuiltInCommand);
+        printCommand(stream, chain->BuiltInCommand);
+        return;
+    }
+    if (chain->loop != NULL) {
+        printLoop(stream, chain->loop);
+        return;
+    }
+    if (chain->timed) {
+        fprintf(stream, "time ");
     }
-    free(chain);
+    if (chain->timeout > 0) {
+        fprintf(stream, "timeout -s %d %gs ", chain->timeoutSignal, chain->timeout / 1000.0);
+    }
+    Pipeline *pipeline = chain->pipelineRedirections->pipeline;
+    for (int i = 0; i < pipeline->numCommands; i++) {
+        if (i > 0) {
+            fprintf(stream, " | ");
+        }
+        printCommand(stream, pipeline->commands[i]);
+    }
+    Redirections *redirections = chain->pipelineRedirections->redirections;
+    printFileList(stream, "<", redirections->inputFiles);
+    printFileList(stream, ">", redirections->outputFiles);
+    printFileList(stream, "n>", redirections->errorFiles);
+}
+
+// write a chain back as a command line, the string has to be freed
+char *formatChain(Chain *chain) {
+    char *line = NULL;
+    size_t len = 0;
+    FILE *stream = open_memstream(&line, &len);
+    printChain(stream, chain);
+    fclose(stream);
+    return line;
 }
\ No newline at end of file
@@ -10,13 +10,24 @@ typedef enum BuiltInCommand {
     BIC_PUSHD,
     BIC_POPD,
     BIC_KILL,
-    BIC_JOBS
+    BIC_JOBS,
+    BIC_HASH,
+    BIC_PIPESIZE,
+    BIC_FANOUT,
+    BIC_WAIT,
+    // utilities that are run by the shell instead of being started
+    BIC_ECHO,
+    BIC_TRUE,
+    BIC_FALSE,
+    BIC_TEST,
+    BIC_PRINTF
 } BuiltInCommand;
 
 // structure for command arguments
 typedef struct Args {
     char **args;
     int numArgs;
+    int capacity;
 } Args;
 
 // structure for command
@@ -30,6 +41,7 @@ typedef struct Command {
 typedef struct Pipeline {
     Command **commands;
     int numCommands;
+    int capacity;
 } Pipeline;
 
 // types of operators
@@ -53,6 +65,7 @@ typedef enum RedirectionType {
 typedef struct FileList {
     char **files;
     int numFiles;
+    int capacity;
 } FileList;
 
 // structure for redirections
@@ -68,36 +81,79 @@ typedef struct PipelineRedirections {
     Redirections *redirections;
 } PipelineRedirections;
 
+typedef struct Loop Loop;
+
 // structure for chain
 typedef struct Chain {
     PipelineRedirections *pipelineRedirections;
     Command *BuiltInCommand;
+    Loop *loop;
+    // whether the resources of the pipeline are reported
+    int timed;
+    // the time limit of the pipeline in milliseconds, 0 for none and -1 if timeout was used wrongly
+    long long timeout;
+    int timeoutSignal;
+    // whether a chain of a block or of the body of a loop runs in the background, the chains of an
+    // input line have the operator after them instead
+    int background;
 } Chain;
 
+// structure for a list of chains, each with the operator that connects it to the previous one
+typedef struct ChainList {
+    Chain **chains;
+    ActiveOperator *operators;
+    int numChains;
+    int capacity;
+    // the number of chains of a parallel block that may run at once, 0 for the default
+    int limit;
+} ChainList;
+
+// types of loops
+typedef enum LoopType {
+    LT_FOR,
+    LT_WHILE
+} LoopType;
+
+// structure for a loop, its body is parsed once and runs for every word or as long as the condition succeeds
+struct Loop {
+    LoopType type;
+    char *variable;
+    FileList *words;
+    ChainList *condition;
+    ChainList *body;
+};
+
 Args *createArgs();
 Args *addArg(Args *args, char *arg);
-void freeArgs(Args *args);
 
 Command *createCommand(char *commandName, Args *commandArgs);
 Command *createBuiltInCommand(BuiltInCommand builtInCommand, Args *commandArgs);
-void freeCommand(Command *command);
 
 Pipeline *createPipeline(Command *command);
 Pipeline *addCommandToPipeline(Pipeline *pipeline, Command *command);
-void freePipeline(Pipeline *pipeline);
 
 FileList *createFileList();
 FileList *addFile(FileList *fileList, char *file);
-void freeFileList(FileList *fileList);
 
 Redirections *createRedirections();
 Redirections *addRedirection(Redirections *redirections, char *file, RedirectionType type);
-void freeRedirections(Redirections *redirections);
 
 PipelineRedirections *createPipelineRedirections(Pipeline *pipeline, Redirections *redirections);
-void freePipelineRedirections(PipelineRedirections *pipelineRedirections);
 
 Chain *createChain(PipelineRedirections *pipelineRedirections, Command *BuiltInCommand);
-void freeChain(Chain *chain);
+Chain *createPipelineChain(Pipeline *pipeline, Redirections *redirections);
+Chain *createTimeoutChain(Pipeline *pipeline, Redirections *redirections);
+
+Loop *createForLoop(char *variable, FileList *words, ChainList *body);
+Loop *createWhileLoop(ChainList *condition, ChainList *body);
+Chain *createLoopChain(Loop *loop);
+
+ChainList *createChainList();
+ChainList *addChainToList(ChainList *chainList, Chain *chain, ActiveOperator operator);
+ChainList *appendChainList(ChainList *chainList, ChainList *other);
+
+char *formatChain(Chain *chain);
+
+extern char *builtInCommandNames[];
 
 #endif
\ No newline at end of file
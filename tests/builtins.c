@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+// Runs short scripts through the shell and checks that each of them finishes in time and writes
+// the expected output. The scripts run in a directory of their own, so they can write files.
+//
+// usage: tests/builtins [shell]
+
+// the seconds a script may take before it counts as hanging
+#define TEST_TIME_LIMIT 5
+
+// structure for a test, a script and the output it has to write; the script can start with lines that
+// write nothing, so it is read in more than one block
+typedef struct ShellTest {
+    char *name;
+    char *script;
+    char *output;
+    int paddingLines;
+} ShellTest;
+
+ShellTest shellTests[] = {
+    // wait in a subshell has no jobs to wait for, it has to fail instead of waiting forever
+    { "wait with a redirection returns", "sleep 0.2 &\nwait > f\n/bin/echo done\n", "done\n" },
+    { "wait as a pipeline stage returns", "sleep 0.2 &\nwait | /bin/cat > f\n/bin/echo done\n", "done\n" },
+    // a built-in that changes the shell still changes it when its output is redirected
+    { "cd with a redirection changes the directory", "/bin/mkdir sub\ncd sub > log\n/bin/touch here\ncd ..\n/bin/ls sub\n", "here\n" },
+    { "exit with a redirection exits", "exit > /dev/null\n/bin/echo after\n", "" },
+    // commands that read the script start at the line after their own, also when it was read in a block
+    { "head reads the next line of the script", "/usr/bin/head -n 1\nline one\n/bin/echo after\n", "line one\nafter\n" },
+    { "head reads the next line after a block", "/usr/bin/head -n 1\nline one\n/bin/echo after\n", "line one\nafter\n", 20000 },
+    { "head on a line with more commands", "/usr/bin/head -n 1; /bin/echo same\nline one\n/bin/echo after\n", "line one\nsame\nafter\n", 20000 },
+    { "cat reads the rest of the script", "/bin/echo before\n/bin/cat\nline one\nline two\n", "before\nline one\nline two\n", 20000 },
+};
+
+// run the shell with the script in the directory, returns 0 if it did not finish in time
+int runTest(char *shell, char *directory, ShellTest *test, char *output, size_t size) {
+    char script[4096], result[4096];
+    snprintf(script, sizeof(script), "%s/test.sh", directory);
+    snprintf(result, sizeof(result), "%s/test.out", directory);
+    FILE *file = fopen(script, "w");
+    for (int i = 0; i < test->paddingLines; i++) {
+        fputs("true\n", file);
+    }
+    fputs(test->script, file);
+    fclose(file);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int input = open(script, O_RDONLY);
+        int out = open(result, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(input, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        if (chdir(directory) != 0) {
+            _exit(127);
+        }
+        // the limit outlives the exec, a hanging shell is stopped by SIGALRM
+        alarm(TEST_TIME_LIMIT);
+        // a shell built with EXT_PROMPT takes the script as its argument and prints no prompt then
+        execl(shell, shell, script, NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+
+    output[0] = '\0';
+    file = fopen(result, "r");
+    if (file != NULL) {
+        size_t len = fread(output, 1, size - 1, file);
+        output[len] = '\0';
+        fclose(file);
+    }
+    return !(WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM);
+}
+
+int main(int argc, char **argv) {
+    char *shell = argc > 1 ? argv[1] : "./shell";
+    char path[4096];
+    if (shell[0] != '/' && realpath(shell, path) != NULL) {
+        shell = path;
+    }
+
+    char directory[] = "/tmp/builtins-test-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    char output[4096];
+    for (int i = 0; i < (int) (sizeof(shellTests) / sizeof(ShellTest)); i++) {
+        ShellTest *test = &shellTests[i];
+        if (!runTest(shell, directory, test, output, sizeof(output))) {
+            fprintf(stdout, "FAIL %s: did not finish in %d seconds\n", test->name, TEST_TIME_LIMIT);
+            failed++;
+        } else if (strcmp(output, test->output) != 0) {
+            fprintf(stdout, "FAIL %s: wrote \"%s\"\n", test->name, output);
+            failed++;
+        } else {
+            fprintf(stdout, "ok   %s\n", test->name);
+        }
+    }
+
+    char command[sizeof(directory) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    system(command);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
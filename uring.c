@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+// set up a ring, returns 0 if io_uring is not available
+int initIoRing(IoRing *ring, unsigned entries) {
+    memset(ring, 0, sizeof(IoRing));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return 0;
+    }
+    // reads and writes at the file position are needed for pipes and appends, they came with Linux 5.6
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(ring->fd);
+        return 0;
+    }
+    ring->entries = params.sq_entries;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap && ring->cqRingSize > ring->sqRingSize) {
+        ring->sqRingSize = ring->cqRingSize;
+    }
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED) {
+        close(ring->fd);
+        return 0;
+    }
+    ring->cqRing = singleMap ? ring->sqRing : mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->cqRing != MAP_FAILED && !singleMap) {
+            munmap(ring->cqRing, ring->cqRingSize);
+        }
+        munmap(ring->sqRing, ring->sqRingSize);
+        close(ring->fd);
+        return 0;
+    }
+    if (singleMap) {
+        ring->cqRingSize = 0;
+    }
+
+    char *sq = ring->sqRing;
+    char *cq = ring->cqRing;
+    ring->sqHead = (unsigned *) (sq + params.sq_off.head);
+    ring->sqTail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *) (sq + params.sq_off.array);
+    ring->cqHead = (unsigned *) (cq + params.cq_off.head);
+    ring->cqTail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    ring->localTail = *ring->sqTail;
+    return 1;
+}
+
+// add a read or write at the file position to the submission queue, returns 0 if the queue is full
+int queueIoRingOperation(IoRing *ring, int opcode, int fd, void *buffer, unsigned len, IoRingRequest *request) {
+    unsigned head = __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+    if (ring->localTail - head >= ring->entries) {
+        return 0;
+    }
+    unsigned index = ring->localTail & *ring->sqMask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long long) (unsigned long) buffer;
+    sqe->len = len;
+    // -1 uses and moves the file position like read and write do
+    sqe->off = (unsigned long long) -1;
+    sqe->user_data = (unsigned long long) (unsigned long) request;
+    ring->sqArray[index] = index;
+    ring->localTail++;
+    ring->numQueued++;
+    request->done = 0;
+    request->result = 0;
+    return 1;
+}
+
+// queue a read from the file position
+int queueIoRingRead(IoRing *ring, int fd, void *buffer, unsigned len, IoRingRequest *request) {
+    return queueIoRingOperation(ring, IORING_OP_READ, fd, buffer, len, request);
+}
+
+// queue a write at the file position
+int queueIoRingWrite(IoRing *ring, int fd, void *buffer, unsigned len, IoRingRequest *request) {
+    return queueIoRingOperation(ring, IORING_OP_WRITE, fd, buffer, len, request);
+}
+
+// enter the ring, submitting and waiting as asked
+int enterIoRing(IoRing *ring, unsigned toSubmit, unsigned waitFor) {
+    while (1) {
+        int result = (int) syscall(__NR_io_uring_enter, ring->fd, toSubmit, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        return result;
+    }
+}
+
+// hand every queued operation to the kernel with one system call
+int submitIoRing(IoRing *ring) {
+    if (ring->numQueued == 0) {
+        return 0;
+    }
+    __atomic_store_n(ring->sqTail, ring->localTail, __ATOMIC_RELEASE);
+    int result = enterIoRing(ring, ring->numQueued, 0);
+    if (result > 0) {
+        ring->numQueued -= result;
+    }
+    return result;
+}
+
+// pass the finished operations to their requests
+void collectIoRingCompletions(IoRing *ring) {
+    unsigned head = *ring->cqHead;
+    unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+        IoRingRequest *request = (IoRingRequest *) (unsigned long) cqe->user_data;
+        request->result = cqe->res;
+        request->done = 1;
+        head++;
+    }
+    __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+}
+
+// wait until an operation is finished and return its result, negative results are -errno
+int waitIoRingRequest(IoRing *ring, IoRingRequest *request) {
+    submitIoRing(ring);
+    collectIoRingCompletions(ring);
+    while (!request->done) {
+        if (enterIoRing(ring, 0, 1) < 0) {
+            return -errno;
+        }
+        collectIoRingCompletions(ring);
+    }
+    return request->result;
+}
+
+// release the ring
+void freeIoRing(IoRing *ring) {
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRingSize > 0) {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+// structure for an operation on the ring and its result
+typedef struct IoRingRequest {
+    int done;
+    int result;
+} IoRingRequest;
+
+// structure for an io_uring instance with its mapped queues
+typedef struct IoRing {
+    int fd;
+    unsigned entries;
+    // the submission queue, entries are added at the local tail and published on submit
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    struct io_uring_sqe *sqes;
+    unsigned localTail;
+    unsigned numQueued;
+    // the completion queue
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    // the mappings of the queues
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+} IoRing;
+
+int initIoRing(IoRing *ring, unsigned entries);
+int queueIoRingRead(IoRing *ring, int fd, void *buffer, unsigned len, IoRingRequest *request);
+int queueIoRingWrite(IoRing *ring, int fd, void *buffer, unsigned len, IoRingRequest *request);
+int submitIoRing(IoRing *ring);
+int waitIoRingRequest(IoRing *ring, IoRingRequest *request);
+void freeIoRing(IoRing *ring);
+
+#endif
\ No newline at end of file
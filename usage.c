@@ -5,23 +5,36 @@
 #include <sys/wait.h>
 #include <string.h>
 #include <fcntl.h>
+#include <errno.h>
 #include "usage.h"
+#include "launch.h"
 #if EXT_PROMPT
 #include "stack.h"
 #endif
 #include "list.h"
+#include "reap.h"
+#include "pathcache.h"
+#include "pump.h"
+#include "account.h"
+#include "pipesize.h"
+#include "arena.h"
+#include "fanout.h"
+#include "fileset.h"
+#include "profile.h"
+#include "workdir.h"
+#include "jobwait.h"
+#include "deadline.h"
+#include "utility.h"
+#include "loop.h"
+#include "lexinput.h"
 
 extern int *status;
-extern char *currentPath;
+extern WorkingDirectory *workingDirectory;
 extern ActiveOperator activeOperator;
 extern ActiveOperator futureOperator;
 extern void finalizeParser();
 
-extern Chain *lastChain;
-extern Pipeline *lastPipeline;
-extern Redirections *lastRedirections;
-extern Command *lastCommand;
-extern Args *lastArgs;
+extern Arena *parseArena;
 
 #if EXT_PROMPT
 extern Stack *directoryStack;
@@ -29,8 +42,11 @@ extern int scriptInput;
 #endif
 
 extern BackgroundList *backgroundList;
+extern PathCache *pathCache;
 
 int foregroundRunning = 0;
+// set in the copy of the shell that runs a background job, its commands stay in the group of the job
+int inBackgroundJob = 0;
 
 void printColor(char *color, char *msg) {
     #if EXT_PROMPT
@@ -44,7 +60,7 @@ void printPrompt() {
     #if EXT_PROMPT
     // do not print the prompt if the input is from a script
     if (!scriptInput) {
-        fprintf(stdout, "%s> ", currentPath);
+        fprintf(stdout, "%s> ", workingDirectory->path);
     }
     #endif
 }
@@ -52,20 +68,9 @@ void printPrompt() {
 // terminate the chain with error
 void terminateChainError(Chain *chain, char *msg) {
     printColor("\033[0;31m", msg);
-    freeChain(chain);
     exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
 }
 
-// handle the child signal
-void sigChildHandler(int signo) {
-    pid_t pid;
-    int status;
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        removeBackgroundProcessByPID(backgroundList, pid);
-        //printf("Process %d has finished with status %d\n", pid, WEXITSTATUS(status));
-    }
-}
-
 // handle the int signal
 void sigIntHandler(int signo) {
     // check if all background processes are finished
@@ -83,6 +88,8 @@ void sigIntHandler(int signo) {
 // handle built-in commands
 void runBuiltInCommand(Chain *chain) {
     Command *command = chain->BuiltInCommand;
+    // exit, kill and jobs have to see which background processes finished
+    reapChildren();
     switch (command->builtInCommand) {
         case BIC_EXIT:
             // check if all background processes are finished
@@ -95,7 +102,6 @@ void runBuiltInCommand(Chain *chain) {
             if (command->commandArgs->numArgs > 0) {
                 exitStatus = command->commandArgs->args[0] != NULL ? atoi(command->commandArgs->args[0]) : 0; // exit with the argument if it exists
             }
-            freeChain(chain);
             finalizeParser();
             exit(exitStatus);
         case BIC_STATUS:
@@ -107,11 +113,10 @@ void runBuiltInCommand(Chain *chain) {
             break;
         case BIC_CD:
             if (command->commandArgs->numArgs > 0) {
-                if (chdir(command->commandArgs->args[0]) != 0) {
+                if (changeWorkingDirectory(workingDirectory, command->commandArgs->args[0]) != 0) {
                     printColor("\033[0;31m", "Error: cd directory not found!\n");
                     *status = 2;
                 } else {
-                    getcwd(currentPath, 1024 * sizeof(char));
                     *status = 0;
                 }
             } else {
@@ -122,14 +127,26 @@ void runBuiltInCommand(Chain *chain) {
         #if EXT_PROMPT
         case BIC_PUSHD:
             if (command->commandArgs->numArgs > 0) {
-                if (chdir(command->commandArgs->args[0]) != 0) {
-                    printColor("\033[0;31m", "Error: pushd directory not found!\n");
+                // the directory is left through a descriptor, so popd does not resolve its path again
+                int fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+                pushStack(directoryStack, fd, workingDirectory->path, workingDirectory->length);
+                if (fd < 0 || changeWorkingDirectory(workingDirectory, command->commandArgs->args[0]) != 0) {
+                    int pushdError = errno;
+                    char *path;
+                    popStack(directoryStack, &path);
+                    if (fd >= 0) {
+                        close(fd);
+                    }
+                    // running out of descriptors is not a missing directory
+                    if (pushdError == ENOENT || pushdError == ENOTDIR) {
+                        printColor("\033[0;31m", "Error: pushd directory not found!\n");
+                    } else {
+                        char message[256];
+                        snprintf(message, sizeof(message), "Error: pushd failed: %s!\n", strerror(pushdError));
+                        printColor("\033[0;31m", message);
+                    }
                     *status = 2;
                 } else {
-                    char *pathToPush = malloc(1024 * sizeof(char));
-                    strcpy(pathToPush, currentPath);
-                    pushStack(directoryStack, (void *) pathToPush);
-                    getcwd(currentPath, 1024 * sizeof(char));
                     *status = 0;
                 }
             } else {
@@ -142,15 +159,15 @@ void runBuiltInCommand(Chain *chain) {
                 printColor("\033[0;31m", "Error: popd directory stack is empty!\n");
                 *status = 2;
             } else {
-                char *path = (char *) popStack(directoryStack);
-                if (chdir(path) != 0) {
+                char *path;
+                int fd = popStack(directoryStack, &path);
+                if (returnToWorkingDirectory(workingDirectory, fd, path) != 0) {
                     printColor("\033[0;31m", "Error: popd directory not found!\n");
                     *status = 2;
                 } else {
-                    getcwd(currentPath, 1024 * sizeof(char));
                     *status = 0;
                 }
-                free(path);
+                close(fd);
             }
             break;
         #endif
@@ -172,37 +189,105 @@ void runBuiltInCommand(Chain *chain) {
                         return;
                     }
                 }
-                pid_t pid = getBackgroundProcessPID(backgroundList, id);
-                if (pid == -1) {
+                BackgroundProcess *process = findBackgroundProcessByID(backgroundList, id);
+                if (process == NULL) {
                     printColor("\033[0;31m", "Error: this index is not a background process!\n");
                     *status = 2;
                     return;
                 }
-                if (kill(pid, signal) < 0) {
+                // a job with its own process group is signalled as a whole, with every stage of its pipeline
+                int killed = process->processGroup > 0 ? killpg(process->processGroup, signal) : kill(process->pid, signal);
+                if (killed < 0) {
                     printColor("\033[0;31m", "Error: the process could not be killed!\n");
-                    freeChain(chain);
                     exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
                 }
+                if (signal != 0) {
+                    process->state = BS_SIGNALLED;
+                }
                 *status = 0;
             } else {
                 printColor("\033[0;31m", "Error: command requires an index!\n");
                 *status = 2;
             }
             break;
-        case BIC_JOBS:
+        case BIC_JOBS: {
+            // -l also shows the pid, state, running time and command line
+            int longFormat = 0;
+            for (int i = 0; i < command->commandArgs->numArgs; i++) {
+                if (strcmp(command->commandArgs->args[i], "-l") != 0) {
+                    printColor("\033[0;31m", "Error: invalid option provided!\n");
+                    *status = 2;
+                    return;
+                }
+                longFormat = 1;
+            }
             if (isEmptyBackgroundList(backgroundList)) {
                 printColor("\033[0;31m", "No background processes!\n");
                 *status = 2;
                 return;
             }
-            printBackgroundList(backgroundList->head);
+            printBackgroundList(backgroundList, longFormat);
             *status = 0;
             break;
+        }
+        case BIC_HASH:
+            *status = 0;
+            if (command->commandArgs->numArgs == 0) {
+                if (isEmptyPathCache(pathCache)) {
+                    printColor("\033[0;31m", "No commands in the hash table!\n");
+                    return;
+                }
+                printPathCache(pathCache);
+                return;
+            }
+            if (strcmp(command->commandArgs->args[0], "-r") == 0) {
+                clearPathCache(pathCache);
+                return;
+            }
+            // look up the given commands so later runs find them in the table
+            for (int i = 0; i < command->commandArgs->numArgs; i++) {
+                if (lookupCommandPath(pathCache, command->commandArgs->args[i]) == NULL) {
+                    printColor("\033[0;31m", "Error: hash command not found!\n");
+                    *status = 2;
+                }
+            }
+            break;
+        case BIC_PIPESIZE:
+            *status = 0;
+            if (command->commandArgs->numArgs == 0) {
+                printPipeSize();
+                return;
+            }
+            if (command->commandArgs->numArgs > 1 || !setPipeSize(command->commandArgs->args[0])) {
+                printColor("\033[0;31m", "Error: invalid pipe size provided!\n");
+                *status = 2;
+            }
+            break;
+        case BIC_FANOUT:
+            runFanout(command, 0);
+            break;
+        case BIC_WAIT:
+            runWait(command);
+            break;
+        case BIC_ECHO:
+        case BIC_TRUE:
+        case BIC_FALSE:
+        case BIC_TEST:
+        case BIC_PRINTF:
+            runUtility(command);
+            break;
     }
 }
 
 // handle running commands
-int runCommand(Command *command, int pipeIn[2], int pipeOut[2], int hasInput, int hasOutput, int input, int output, int error) {
+int runCommand(Command *command, int pipeIn[2], int pipeOut[2], int hasInput, int hasOutput, int input, int output, int error, pid_t processGroup) {
+    // find the command before creating a child process
+    char *path = lookupCommandPath(pathCache, command->commandName);
+    if (path == NULL) {
+        printColor("\033[0;31m", "Error: command not found!\n");
+        return -1;
+    }
+
     // ignore the SIGINT signal for main
     struct sigaction sigint;
     sigemptyset(&sigint.sa_mask);
@@ -210,327 +295,556 @@ int runCommand(Command *command, int pipeIn[2], int pipeOut[2], int hasInput, in
     sigint.sa_handler = SIG_IGN;
     sigaction(SIGINT, &sigint, NULL);
 
-    pid_t pid = fork();
+    // describe the setup of the child process
+    SpawnPlan plan;
+    initSpawnPlan(&plan);
+    // reset the child and int signal handlers for the child processes
+    addSpawnDefaultSignal(&plan, SIGCHLD);
+    addSpawnDefaultSignal(&plan, SIGINT);
+    setSpawnProcessGroup(&plan, processGroup);
+
+    // every descriptor of the shell is closed on exec, the child only keeps what is moved to 0, 1 and 2
+    if (error != -1) {
+        // send the error to the file
+        addSpawnDup2(&plan, error, STDERR_FILENO);
+    }
+    if (hasInput) {
+        // move the output of the previous command to stdin
+        addSpawnDup2(&plan, pipeIn[0], STDIN_FILENO);
+    } else if (input != -1) {
+        // get the input from the file
+        addSpawnDup2(&plan, input, STDIN_FILENO);
+    }
+    if (hasOutput) {
+        // move the output of the current command to stdout
+        addSpawnDup2(&plan, pipeOut[1], STDOUT_FILENO);
+    } else {
+        // send the output to the file
+        addSpawnDup2(&plan, output, STDOUT_FILENO);
+    }
+
+    long long start = startProfileSpan();
+    pid_t pid = spawnProcess(&plan, path, command->commandArgs->args);
+    endProfileSpan(PF_SPAWN, start, command->commandName);
+
+    if (pid < 0) {
+        if (errno == EAGAIN || errno == ENOMEM) {
+            printColor("\033[0;31m", "Error: fork() could not create a child process!\n");
+            exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
+        }
+        printColor("\033[0;31m", "Error: command not found!\n");
+    }
+    return pid;
+}
+
+// check if a built-in command only reports, signals or writes, so it can run in the shell as a pipeline stage
+int isReportingBuiltIn(Command *command) {
+    switch (command->builtInCommand) {
+        case BIC_STATUS:
+        case BIC_KILL:
+        case BIC_JOBS:
+        case BIC_ECHO:
+        case BIC_TRUE:
+        case BIC_FALSE:
+        case BIC_TEST:
+        case BIC_PRINTF:
+            return 1;
+        case BIC_HASH:
+        case BIC_PIPESIZE:
+            return command->commandArgs->numArgs == 0;
+        default:
+            return 0;
+    }
+}
+
+// check if a built-in command changes the shell, so on its own with redirections it still has to run in the shell
+int changesShell(Command *command) {
+    switch (command->builtInCommand) {
+        case BIC_EXIT:
+        case BIC_CD:
+        case BIC_PUSHD:
+        case BIC_POPD:
+        case BIC_HASH:
+        case BIC_PIPESIZE:
+        case BIC_WAIT:
+            return 1;
+        default:
+            return 0;
+    }
+}
 
+// start a built-in pipeline stage, returns 0 if it runs in the shell once the other stages are started
+pid_t startBuiltInStage(Command *command, BuiltInStage *stage, int hasInput, int pipeIn[2], int input, int hasOutput, int pipeOut[2], int output, int error, int inShell, pid_t processGroup) {
+    int stageOutput = hasOutput ? pipeOut[1] : output;
+    if (inShell) {
+        // keep the descriptors, the pipes are closed while the next stages start
+        stage->command = command;
+        stage->output = fcntl(stageOutput, F_DUPFD_CLOEXEC, 0);
+        stage->error = error != -1 ? fcntl(error, F_DUPFD_CLOEXEC, 0) : -1;
+        return 0;
+    }
+
+    // built-ins that change the shell run in a child, so the shell itself is not changed
+    pid_t pid = fork();
     if (pid < 0) {
         printColor("\033[0;31m", "Error: fork() could not create a child process!\n");
-        freeCommand(command);
         exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
     } else if (pid == 0) {
-        // reset the child signal handler for the child processes
-        struct sigaction sigchild;
-        sigemptyset(&sigchild.sa_mask);
-        sigchild.sa_flags = SA_RESTART;
-        sigchild.sa_handler = SIG_DFL;
-        sigaction(SIGCHLD, &sigchild, NULL);
-
-        // reset the int signal handler for the child processes
+        // the subshell has no children of the shell, the jobs are only collected by the shell itself
+        finalizeChildReaper();
+        // join the process group of the pipeline like the other stages, 0 leads a new one
+        if (processGroup >= 0) {
+            setpgid(0, processGroup);
+        }
+        // reset the int signal handler for the child process
         struct sigaction sigint;
         sigemptyset(&sigint.sa_mask);
         sigint.sa_flags = SA_RESTART;
         sigint.sa_handler = SIG_DFL;
         sigaction(SIGINT, &sigint, NULL);
 
-        // child code
-        if (error != -1) {
-            // send the error to the file
-            dup2(error, STDERR_FILENO);
-            // close the file
-            close(error);
-        }
+        // a fan-out reads its items from the previous stage
         if (hasInput) {
-            // close the write end of the previous pipe
-            close(pipeIn[1]);
-            if (pipeIn[0] != STDIN_FILENO) {
-                // move the output of the previous command to stdin
-                dup2(pipeIn[0], STDIN_FILENO);
-                // close the read end of the previous pipe
-                close(pipeIn[0]);
-            }
-        } else {
-            if (input != -1 && input != STDIN_FILENO) {
-                // get the input from the file
-                dup2(input, STDIN_FILENO);
-                // close the file
-                close(input);
-            }
+            dup2(pipeIn[0], STDIN_FILENO);
+        } else if (input != -1 && input != STDIN_FILENO) {
+            dup2(input, STDIN_FILENO);
         }
+        // the subshell does not exec, so it drops the read end of its own pipe itself
         if (hasOutput) {
-            // close the read end of the current pipe
             close(pipeOut[0]);
-            if (pipeOut[1] != STDOUT_FILENO) {
-                // move the output of the current command to stdout
-                dup2(pipeOut[1], STDOUT_FILENO);
-                // close the write end of the current pipe
-                close(pipeOut[1]);
-            }
-        } else {
-            if (output != STDOUT_FILENO) {
-                // send the output to the file
-                dup2(output, STDOUT_FILENO);
-                // close the file
-                close(output);
-            }
         }
-        execvp(command->commandName, command->commandArgs->args);
-        printColor("\033[0;31m", "Error: command not found!\n");
-        freeCommand(command);
-        exit(127);
+        dup2(stageOutput, STDOUT_FILENO);
+        if (error != -1) {
+            dup2(error, STDERR_FILENO);
+        }
+        runBuiltInCommand(createChain(NULL, command));
+        exit(*status);
+    }
+    // the group is also set here, so it exists before the next stage joins it
+    if (processGroup >= 0) {
+        setpgid(pid, processGroup == 0 ? pid : processGroup);
     }
     return pid;
 }
 
-// check if the files are equal
-int checkFiles(char **inputFiles, int numInputFiles, char **outputFiles, int numOutputFiles, char **errorFiles, int numErrorFiles) {
-    #if EXT_PROMPT
-    // check if any of the input, output, or error files are the same
-    for (int i = 0; i < numInputFiles; i++) {
-        for (int j = 0; j < numOutputFiles; j++) {
-            if (inputFiles[i] != NULL && outputFiles[j] != NULL && strcmp(inputFiles[i], outputFiles[j]) == 0) {
-                printColor("\033[0;31m", "Error: input and output files cannot be equal!\n");
-                return 0;
-            }
+// run the built-in stages that stay in the shell, with their output sent into the pipeline
+void runBuiltInStages(BuiltInStage *stages, pid_t *ids, int numCommands) {
+    // a stage whose reader is gone gets EPIPE instead of stopping the shell
+    struct sigaction sigpipe, previousSigpipe;
+    sigemptyset(&sigpipe.sa_mask);
+    sigpipe.sa_flags = 0;
+    sigpipe.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sigpipe, &previousSigpipe);
+
+    // status reports the status from before the pipeline
+    int previousStatus = *status;
+    for (int i = 0; i < numCommands; i++) {
+        if (ids[i] != 0) {
+            continue;
         }
-        for (int j = 0; j < numErrorFiles; j++) {
-            if (inputFiles[i] != NULL && errorFiles[j] != NULL && strcmp(inputFiles[i], errorFiles[j]) == 0) {
-                printColor("\033[0;31m", "Error: input and error files cannot be equal!\n");
-                return 0;
-            }
+        fflush(stdout);
+        fflush(stderr);
+        int savedOutput = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+        dup2(stages[i].output, STDOUT_FILENO);
+        close(stages[i].output);
+        int savedError = -1;
+        if (stages[i].error != -1) {
+            savedError = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 0);
+            dup2(stages[i].error, STDERR_FILENO);
+            close(stages[i].error);
+        }
+
+        *status = previousStatus;
+        runBuiltInCommand(createChain(NULL, stages[i].command));
+        stages[i].status = *status;
+
+        fflush(stdout);
+        fflush(stderr);
+        dup2(savedOutput, STDOUT_FILENO);
+        close(savedOutput);
+        if (savedError != -1) {
+            dup2(savedError, STDERR_FILENO);
+            close(savedError);
         }
     }
+    *status = previousStatus;
+    sigaction(SIGPIPE, &previousSigpipe, NULL);
+}
+
+// open a file that is written, it is only truncated once it is known that it is not also read
+int openWrittenFile(char *file, RedirectionFiles *files) {
+    int fd = open(file, O_WRONLY | O_CLOEXEC);
+    if (fd >= 0 || errno != ENOENT) {
+        return fd;
+    }
+    fd = open(file, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd >= 0) {
+        // the shell made the file, it is removed again if the redirections conflict
+        files->created[files->numCreated++] = file;
+    } else if (errno == EEXIST) {
+        fd = open(file, O_WRONLY | O_CLOEXEC);
+    }
+    return fd;
+}
+
+// close the opened files of the redirections and remove the files the shell made
+void closeRedirectionFiles(RedirectionFiles *files, int numInputFiles, int numOutputFiles, int numErrorFiles) {
+    for (int i = 0; i < numInputFiles; i++) {
+        close(files->input[i]);
+    }
     for (int i = 0; i < numOutputFiles; i++) {
-        for (int j = 0; j < numErrorFiles; j++) {
-            if (outputFiles[i] != NULL && errorFiles[j] != NULL && strcmp(outputFiles[i], errorFiles[j]) == 0) {
-                printColor("\033[0;31m", "Error: output and error files cannot be equal!\n");
-                return 0;
-            }
+        close(files->output[i]);
+    }
+    for (int i = 0; i < numErrorFiles; i++) {
+        close(files->error[i]);
+    }
+    for (int i = 0; i < files->numCreated; i++) {
+        unlink(files->created[i]);
+    }
+    free(files->input);
+    free(files->output);
+    free(files->error);
+    free(files->created);
+}
+
+// open every file of the redirections once, a file that is both read and written is found by its device and inode
+int openRedirectionFiles(Chain *chain, RedirectionFiles *files) {
+    FileList *inputFiles = chain->pipelineRedirections->redirections->inputFiles;
+    FileList *outputFiles = chain->pipelineRedirections->redirections->outputFiles;
+    FileList *errorFiles = chain->pipelineRedirections->redirections->errorFiles;
+
+    files->input = malloc((inputFiles->numFiles + 1) * sizeof(int));
+    files->output = malloc((outputFiles->numFiles + 1) * sizeof(int));
+    files->error = malloc((errorFiles->numFiles + 1) * sizeof(int));
+    files->created = malloc((outputFiles->numFiles + errorFiles->numFiles + 1) * sizeof(char *));
+    files->numCreated = 0;
+
+    // the files are opened before any stage starts, so only the stage they are moved to gets them
+    FileSet set;
+    initFileSet(&set, inputFiles->numFiles + outputFiles->numFiles + errorFiles->numFiles);
+    // written files are opened first, so an input that does not exist yet is found as the same file
+    for (int i = 0; i < errorFiles->numFiles; i++) {
+        files->error[i] = openWrittenFile(errorFiles->files[i], files);
+        if (files->error[i] < 0) {
+            terminateChainError(chain, "Error: error file could not be created!\n");
         }
+        addFileToSet(&set, files->error[i], FR_ERROR);
     }
-    #else
-    // check if input and output files are the same
-    if (inputFiles[0] != NULL && outputFiles[0] != NULL && strcmp(inputFiles[0], outputFiles[0]) == 0) {
-        printColor("\033[0;31m", "Error: input and output files cannot be equal!\n");
+    for (int i = 0; i < outputFiles->numFiles; i++) {
+        files->output[i] = openWrittenFile(outputFiles->files[i], files);
+        if (files->output[i] < 0) {
+            terminateChainError(chain, "Error: output file could not be created!\n");
+        }
+        addFileToSet(&set, files->output[i], FR_OUTPUT);
+    }
+    for (int i = 0; i < inputFiles->numFiles; i++) {
+        files->input[i] = open(inputFiles->files[i], O_RDONLY | O_CLOEXEC);
+        if (files->input[i] < 0) {
+            terminateChainError(chain, "Error: input file not found!\n");
+        }
+        addFileToSet(&set, files->input[i], FR_INPUT);
+    }
+
+    char *msg = NULL;
+    if (hasFileSetConflict(&set, FR_INPUT, FR_OUTPUT)) {
+        msg = "Error: input and output files cannot be equal!\n";
+    } else if (hasFileSetConflict(&set, FR_INPUT, FR_ERROR)) {
+        msg = "Error: input and error files cannot be equal!\n";
+    } else if (hasFileSetConflict(&set, FR_OUTPUT, FR_ERROR)) {
+        msg = "Error: output and error files cannot be equal!\n";
+    }
+    freeFileSet(&set);
+    if (msg != NULL) {
+        printColor("\033[0;31m", msg);
+        closeRedirectionFiles(files, inputFiles->numFiles, outputFiles->numFiles, errorFiles->numFiles);
         return 0;
     }
-    #endif
 
+    // nothing reads the written files, so they are emptied like O_TRUNC would
+    for (int i = 0; i < outputFiles->numFiles; i++) {
+        ftruncate(files->output[i], 0);
+    }
+    for (int i = 0; i < errorFiles->numFiles; i++) {
+        ftruncate(files->error[i], 0);
+    }
+    free(files->created);
     return 1;
 }
 
-// open the error file
-int openErrorFile(char *errorFile, Chain *chain) {
-    int error = -1;
-    if (errorFile != NULL) {
-        error = open(errorFile, O_WRONLY | O_CREAT | O_TRUNC);
-        if (error < 0) {
-            terminateChainError(chain, "Error: error file could not be created!\n");
-        }
+// start copying a pipe into several opened files and return the write end of the pipe
+int startOutputFanout(int *fds, int numFiles, Chain *chain, OutputFanout *fanout) {
+    // the files are written while the pipeline runs
+    int output = addOutputFanout(fanout, fds, numFiles);
+    if (output < 0) {
+        terminateChainError(chain, "Error: pipe() could not be created!\n");
     }
+    return output;
+}
 
+// get the error file
+int openErrorFile(int *errorFiles, int numErrorFiles, Chain *chain, Pump *pump) {
+    if (numErrorFiles > 1) {
+        return startOutputFanout(errorFiles, numErrorFiles, chain, &pump->error);
+    }
+    int error = numErrorFiles == 1 ? errorFiles[0] : -1;
+    free(errorFiles);
     return error;
 }
 
-// open the input files
-int openInputFiles(char **inputFiles, int numInputFiles, Chain *chain) {
+// get the input file
+int openInputFiles(int *inputFiles, int numInputFiles, Chain *chain, Pump *pump) {
     int input = -1;
-    if (inputFiles[0] != NULL) {
-        #if EXT_PROMPT
-        int pipeInput[2];
-        if (pipe(pipeInput) < 0) {
-            terminateChainError(chain, "Error: pipe() could not be created!\n");
-        }
-        input = pipeInput[0];
-        // copy all input into the pipe
-        for (int i = 0; i < numInputFiles; i++) {
-            // open the input file
-            int file = open(inputFiles[i], O_RDONLY);
-            if (file < 0) {
-                terminateChainError(chain, "Error: input file not found!\n");
-            }
-            // copy the input into the pipe
-            char buffer[4096];
-            ssize_t len;
-            while ((len = read(file, buffer, 4096)) > 0) {
-                write(pipeInput[1], buffer, len);
-            }
-            write(pipeInput[1], "\n", 1);
-            close(file);
-        }
-        close(pipeInput[1]);
-        #else
-        input = open(inputFiles[0], O_RDONLY);
+    if (numInputFiles > 1) {
+        // the files are streamed into the pipe while the pipeline runs
+        input = addInputFeed(pump, inputFiles, numInputFiles);
         if (input < 0) {
-            terminateChainError(chain, "Error: input file not found!\n");
+            terminateChainError(chain, "Error: pipe() could not be created!\n");
         }
-        #endif
+        return input;
+    }
+    if (numInputFiles == 1) {
+        // a single file is given to the command directly
+        input = inputFiles[0];
+    } else if (futureOperator != AO_AND_STATEMENT) {
+        input = STDIN_FILENO;
     } else {
-        // check if the process should be ran in the background
-        if (futureOperator != AO_AND_STATEMENT) {
-            input = STDIN_FILENO;
-        }
+        // a background job in a group of its own would be stopped by SIGTTIN if it read the terminal
+        input = open("/dev/null", O_RDONLY | O_CLOEXEC);
     }
+    free(inputFiles);
 
     return input;
 }
 
-// open the output file
-int openOutputFile(char *outputFile, Chain *chain) {
-    int output = -1;
-    if (outputFile != NULL) {
-        output = open(outputFile, O_WRONLY | O_CREAT | O_TRUNC);
-        if (output < 0) {
-            terminateChainError(chain, "Error: output file could not be created!\n");
-        }
-    } else {
-        output = STDOUT_FILENO;
+// get the output file
+int openOutputFile(int *outputFiles, int numOutputFiles, Chain *chain, Pump *pump) {
+    if (numOutputFiles > 1) {
+        return startOutputFanout(outputFiles, numOutputFiles, chain, &pump->output);
     }
-
+    int output = numOutputFiles == 1 ? outputFiles[0] : STDOUT_FILENO;
+    free(outputFiles);
     return output;
 }
 
-// copy the output into the files
-void duplicateOutput(char **outputFiles, int numOutputFiles, Chain *chain) {
-    if (outputFiles[0] != NULL) {
-        for (int i = 1; i < numOutputFiles; i++) {
-            // open the first output file
-            int output = open(outputFiles[0], O_RDONLY);
-            if (output < 0) {
-                terminateChainError(chain, "Error: output file could not be read!\n");
-            }
-            // open the copy of the output file
-            int copy = open(outputFiles[i], O_WRONLY | O_CREAT | O_TRUNC);
-            if (copy < 0) {
-                terminateChainError(chain, "Error: output file could not be created!\n");
-            }
-            // copy the output into the file
-            char buffer[4096];
-            ssize_t len;
-            while ((len = read(output, buffer, 4096)) > 0) {
-                write(copy, buffer, len);
-            }
-            close(copy);
-            close(output);
-        }
-    }
-}
-
-// copy the error into the files
-void duplicateError(char **errorFiles, int numErrorFiles, Chain *chain) {
-    if (errorFiles[0] != NULL) {
-        for (int i = 1; i < numErrorFiles; i++) {
-            // open the first error file
-            int error = open(errorFiles[0], O_RDONLY);
-            if (error < 0) {
-                terminateChainError(chain, "Error: error file could not be read!\n");
-            }
-            // open the copy of the error file
-            int copy = open(errorFiles[i], O_WRONLY | O_CREAT | O_TRUNC);
-            if (copy < 0) {
-                terminateChainError(chain, "Error: error file could not be created!\n");
-            }
-            // copy the error into the file
-            char buffer[4096];
-            ssize_t len;
-            while ((len = read(error, buffer, 4096)) > 0) {
-                write(copy, buffer, len);
-            }
-            close(copy);
-            close(error);
-        }
+// handle the pipeline, a background pipeline is left running as a job in its own process group
+void runPipeline(Chain *chain, int background) {
+    if (chain->timeout < 0) {
+        printColor("\033[0;31m", "Error: invalid timeout provided!\n");
+        *status = TIMEOUT_USAGE_STATUS;
+        return;
     }
-}
-
-// handle the pipeline
-void runPipeline(Chain *chain) {
-    char **inputFiles = chain->pipelineRedirections->redirections->inputFiles->files;
-    char **outputFiles = chain->pipelineRedirections->redirections->outputFiles->files;
-    char **errorFiles = chain->pipelineRedirections->redirections->errorFiles->files;
-
     int numInputFiles = chain->pipelineRedirections->redirections->inputFiles->numFiles;
     int numOutputFiles = chain->pipelineRedirections->redirections->outputFiles->numFiles;
     int numErrorFiles = chain->pipelineRedirections->redirections->errorFiles->numFiles;
 
-    if (!checkFiles(inputFiles, numInputFiles, outputFiles, numOutputFiles, errorFiles, numErrorFiles)) {
-        freeChain(chain);
+    // a built-in that changes the shell and is only a pipeline for its redirections runs in the shell,
+    // as in a subshell it would change nothing
+    Command *firstCommand = chain->pipelineRedirections->pipeline->commands[0];
+    int shellBuiltIn = !background && chain->pipelineRedirections->pipeline->numCommands == 1 && changesShell(firstCommand);
+    if (shellBuiltIn && (numInputFiles > 1 || numOutputFiles > 1 || numErrorFiles > 1)) {
+        printColor("\033[0;31m", "Error: a built-in can only be redirected to one file of each kind!\n");
+        *status = 2;
+        return;
+    }
+
+    RedirectionFiles files;
+    if (!openRedirectionFiles(chain, &files)) {
         *status = 2;
         return;
     }
 
+    // the shell waits for its own stages, finished background jobs are collected afterwards; a built-in
+    // in the shell has no stages to wait for, and wait needs the jobs to be collected
+    if (!background && !shellBuiltIn) {
+        pauseChildReaper(1);
+    }
+
     int numCommands = chain->pipelineRedirections->pipeline->numCommands;
-    int **pipeFiles = malloc((numCommands - 1) * sizeof(int *));
 
-    for (int i = 0; i < numCommands - 1; i++) {
-        pipeFiles[i] = malloc(2 * sizeof(int));
-        // create the pipes
-        if (pipe(pipeFiles[i]) < 0) {
-            terminateChainError(chain, "Error: pipe() could not be created!\n");
-        }
+    // in auto mode the pipes are sized from how often the stages switch
+    PipeSizeSample pipeSizeSample;
+    if (isAutoPipeSize() && !background) {
+        startPipeSizeSample(&pipeSizeSample);
     }
 
-    // the ids of the child processes
+    // the ids of the child processes, 0 for built-in stages that run in the shell
     int *ids = malloc(numCommands * sizeof(int));
+    BuiltInStage *builtInStages = malloc(numCommands * sizeof(BuiltInStage));
+    // built-ins can only write into the pipeline directly while the shell does not have to move data for it
+    int builtInsInShell = numInputFiles <= 1 && numOutputFiles <= 1 && numErrorFiles <= 1;
+
+    // the data the shell moves while the pipeline runs
+    Pump pump;
+    initPump(&pump);
+
+    // the resources of the stages are collected for time and SHELL_TIME
+    int accounting = chain->timed || isAccountingEnabled();
+    PipelineUsage usage;
+    if (accounting) {
+        startPipelineUsage(&usage, numCommands);
+    }
+
+    int error = openErrorFile(files.error, numErrorFiles, chain, &pump);
+    int firstInput = openInputFiles(files.input, numInputFiles, chain, &pump);
+    int lastOutput = openOutputFile(files.output, numOutputFiles, chain, &pump);
 
-    int error = openErrorFile(errorFiles[0], chain);
+    // variables for the previous pipe and the current pipe, a pipe only exists while the stages around it start
+    // and the shell closes its ends as soon as they are handed over, so it holds at most one pipe at a time
+    int pipeIn[2] = { -1, -1 };
+    int pipeOut[2] = { -1, -1 };
+    // a pipeline with a time limit is stopped through the process group of its stages
+    Deadline deadline;
+    initDeadline(&deadline);
+    if (chain->timeout > 0 && !startDeadline(&deadline, chain->timeout, chain->timeoutSignal)) {
+        terminateChainError(chain, "Error: the timeout could not be started!\n");
+    }
+
+    // the first stage that starts leads the process group of a background pipeline, or of a pipeline
+    // with a time limit unless it already runs in the group of a background job
+    pid_t processGroup = background || (deadline.timer >= 0 && !inBackgroundJob) ? 0 : -1;
 
     for (int i = 0; i < numCommands; i++) {
         Command *command = chain->pipelineRedirections->pipeline->commands[i];
-        // variables for the previous pipe and the current pipe
-        int pipeIn[2], pipeOut[2];
         // variable for whether the pipe has input from a previous command
         int hasInput = i > 0;
         // variable for whether the pipe has output for a next command
         int hasOutput = i < (numCommands - 1);
 
-        // the current pipe's input and output
-        if (i < numCommands - 1) {
-            pipeOut[0] = pipeFiles[i][0];
-            pipeOut[1] = pipeFiles[i][1];
-        }
-        // the previous pipe's input and output
-        if (i > 0) {
-            pipeIn[0] = pipeFiles[i-1][0];
-            pipeIn[1] = pipeFiles[i-1][1];
+        // create the current pipe, close-on-exec so only the stages it is moved to keep it
+        if (hasOutput) {
+            if (pipe2(pipeOut, O_CLOEXEC) < 0) {
+                terminateChainError(chain, "Error: pipe() could not be created!\n");
+            }
+            sizePipe(pipeOut[1]);
         }
-        int input = -1;
-        int output = -1;
+        // the first command reads the input files and the last command writes the output files
+        int input = i == 0 ? firstInput : -1;
+        int output = i == numCommands - 1 ? lastOutput : -1;
 
-        // for the first command
-        if (i == 0) {
-            input = openInputFiles(inputFiles, numInputFiles, chain);
+        // a utility the shell cannot give the same result for runs as the program
+        if (command->builtInCommand != BIC_NONE && (!isUtility(command->builtInCommand) || canRunUtility(command))) {
+            int inShell = builtInsInShell && (isReportingBuiltIn(command) || shellBuiltIn);
+            ids[i] = startBuiltInStage(command, &builtInStages[i], hasInput, pipeIn, input, hasOutput, pipeOut, output, error, inShell, processGroup);
+        } else {
+            ids[i] = runCommand(command, pipeIn, pipeOut, hasInput, hasOutput, input, output, error, processGroup);
         }
-
-        // for the last command
-        if (i == numCommands - 1) {
-            output = openOutputFile(outputFiles[0], chain);
+        // every forked stage joins the group, built-in stages that fork a subshell too
+        if (processGroup == 0 && ids[i] > 0) {
+            processGroup = ids[i];
+        }
+        if (accounting) {
+            startStageUsage(&usage, i, ids[i], command->builtInCommand != BIC_NONE ? builtInCommandNames[command->builtInCommand] : command->commandName);
         }
 
-        ids[i] = runCommand(command, pipeIn, pipeOut, hasInput, hasOutput, input, output, error);
-
-        if (i == 0 && inputFiles[0] != NULL) {
+        if (i == 0 && input >= 0 && input != STDIN_FILENO) {
             close(input);
         }
 
-        if (i == numCommands - 1 && outputFiles[0] != NULL) {
+        if (i == numCommands - 1 && numOutputFiles > 0) {
             close(output);
         }
         
-        if (i > 0) {
-            close(pipeFiles[i-1][0]);
-            close(pipeFiles[i-1][1]);
+        // the previous pipe is read by this stage now, the current one is written by it
+        if (hasInput) {
+            close(pipeIn[0]);
+        }
+        if (hasOutput) {
+            close(pipeOut[1]);
+            pipeIn[0] = pipeOut[0];
+            pipeIn[1] = -1;
         }
     }
 
-    if (errorFiles[0] != NULL) {
+    if (numErrorFiles > 0) {
         close(error);
     }
 
+    if (background) {
+        // the stages are collected by the child reaper as the processes of one job
+        int numStarted = 0;
+        int lastStage = -1;
+        for (int i = 0; i < numCommands; i++) {
+            if (ids[i] > 0) {
+                if (i == numCommands - 1) {
+                    lastStage = numStarted;
+                }
+                ids[numStarted++] = ids[i];
+            }
+        }
+        if (numStarted > 0) {
+            char *commandLine = formatChain(chain);
+            addBackgroundJob(backgroundList, ids, numStarted, lastStage, processGroup, commandLine);
+            free(commandLine);
+        }
+        free(ids);
+        free(builtInStages);
+        if (accounting) {
+            freePipelineUsage(&usage);
+        }
+        // set the int signal handler for main
+        struct sigaction sigint;
+        sigemptyset(&sigint.sa_mask);
+        sigint.sa_flags = SA_RESTART;
+        sigint.sa_handler = &sigIntHandler;
+        sigaction(SIGINT, &sigint, NULL);
+        return;
+    }
+
+    setDeadlineStages(&deadline, processGroup, ids, numCommands);
+
+    // the built-in stages write while the other stages read
+    runBuiltInStages(builtInStages, ids, numCommands);
+
+    // feed the input files to the pipeline and copy its output into the files, measured stages are
+    // collected meanwhile as they exit
+    pump.usage = accounting ? &usage : NULL;
+    long long start = startProfileSpan();
+    runPump(&pump, &deadline);
+    endProfileSpan(PF_PUMP, start, NULL);
+
+    if (accounting) {
+        // the limit is watched while the rest of the stages are collected
+        start = startProfileSpan();
+        waitPipelineUsage(&usage, &deadline);
+        endProfileSpan(PF_WAIT, start, NULL);
+        reportPipelineUsage(&usage);
+    } else {
+        // stop the stages if they run longer than the limit
+        waitDeadline(&deadline);
+    }
+
     for (int i = 0; i < numCommands; i++) {
-        waitpid(ids[i], status, 0);
+        if (ids[i] < 0) {
+            // the command could not be launched
+            *status = 127;
+            continue;
+        }
+        if (ids[i] == 0) {
+            *status = builtInStages[i].status;
+            continue;
+        }
+        if (accounting) {
+            *status = usage.stages[i].status;
+        } else {
+            start = startProfileSpan();
+            waitpid(ids[i], status, 0);
+            endProfileSpan(PF_WAIT, start, chain->pipelineRedirections->pipeline->commands[i]->commandName);
+        }
         if (WIFEXITED(*status)) {
             *status = WEXITSTATUS(*status); // get the exit status in regular format
         }
     }
 
+    if (isAutoPipeSize()) {
+        finishPipeSizeSample(&pipeSizeSample, numCommands - 1);
+    }
+
+    // like coreutils, a pipeline that ran out of time fails with 124, or 137 if it was killed
+    if (deadline.expired) {
+        *status = deadline.signal == SIGKILL ? TIMEOUT_KILLED_STATUS : TIMEOUT_EXPIRED_STATUS;
+    }
+    stopDeadline(&deadline);
+
     // set the int signal handler for main
     struct sigaction sigint;
     sigemptyset(&sigint.sa_mask);
@@ -538,68 +852,148 @@ void runPipeline(Chain *chain) {
     sigint.sa_handler = &sigIntHandler;
     sigaction(SIGINT, &sigint, NULL);
 
-    for (int i = 0; i < numCommands - 1; i++) {
-        free(pipeFiles[i]);
+    if (accounting) {
+        freePipelineUsage(&usage);
     }
-
     free(ids);
-    free(pipeFiles);
-
-    // copy the output into all the given files
-    duplicateOutput(outputFiles, numOutputFiles, chain);
-
-    // copy the error into all the given files
-    duplicateError(errorFiles, numErrorFiles, chain);
+    free(builtInStages);
+    pauseChildReaper(0);
+}
 
-    freeChain(chain);
+// check if a chain is a single utility the shell can run on its own, without files, pipes or usage to report
+int runsUtilityDirectly(Chain *chain) {
+    Pipeline *pipeline = chain->pipelineRedirections->pipeline;
+    Redirections *redirections = chain->pipelineRedirections->redirections;
+    if (pipeline->numCommands != 1 || !isUtility(pipeline->commands[0]->builtInCommand)) {
+        return 0;
+    }
+    if (chain->timed || chain->timeout != 0 || isAccountingEnabled()) {
+        return 0;
+    }
+    if (redirections->inputFiles->numFiles > 0 || redirections->outputFiles->numFiles > 0 || redirections->errorFiles->numFiles > 0) {
+        return 0;
+    }
+    return canRunUtility(pipeline->commands[0]);
 }
 
 // run chain component
 void runChainComponent(Chain *chain) {
     // run the built-in command if it exists
     if (chain->BuiltInCommand != NULL) {
+        long long start = startProfileSpan();
         runBuiltInCommand(chain);
-        freeChain(chain);
+        endProfileSpan(PF_BUILTIN, start, builtInCommandNames[chain->BuiltInCommand->builtInCommand]);
+        return;
+    }
+    // run the loop if it exists
+    if (chain->loop != NULL) {
+        runLoop(chain->loop);
+        return;
+    }
+    // a utility writes to the output of the shell directly
+    if (runsUtilityDirectly(chain)) {
+        Command *command = chain->pipelineRedirections->pipeline->commands[0];
+        long long start = startProfileSpan();
+        runUtility(command);
+        endProfileSpan(PF_BUILTIN, start, command->commandName);
         return;
     }
     // run the pipeline if it exists
-    runPipeline(chain);
+    runPipeline(chain, 0);
+}
+
+// check if a background chain can be started by the shell itself, without a copy of the shell
+// that waits for it: no built-ins, no data the shell has to move and no usage to report
+int startsInBackground(Chain *chain) {
+    if (chain->BuiltInCommand != NULL || chain->loop != NULL || chain->timed || chain->timeout != 0 || isAccountingEnabled()) {
+        return 0;
+    }
+    Redirections *redirections = chain->pipelineRedirections->redirections;
+    if (redirections->inputFiles->numFiles > 1 || redirections->outputFiles->numFiles > 1 || redirections->errorFiles->numFiles > 1) {
+        return 0;
+    }
+    Pipeline *pipeline = chain->pipelineRedirections->pipeline;
+    for (int i = 0; i < pipeline->numCommands; i++) {
+        if (pipeline->commands[i]->builtInCommand != BIC_NONE) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// check if a chain reads the shell's input
+int chainReadsInput(Chain *chain) {
+    if (chain->BuiltInCommand != NULL) {
+        return fanoutReadsInput(chain->BuiltInCommand);
+    }
+    // the chains of a loop give the input to their commands themselves
+    if (chain->loop != NULL) {
+        return 0;
+    }
+    // only the first stage reads the input, and the utilities never do
+    if (isUtility(chain->pipelineRedirections->pipeline->commands[0]->builtInCommand)) {
+        return 0;
+    }
+    return chain->pipelineRedirections->redirections->inputFiles->numFiles == 0;
 }
 
 // handle running chains
 void runChain(Chain *chain) {
     // for && don't run if the previous chain failed
     if (activeOperator == AO_AND_OPERATOR && status != NULL && *status != 0) {
-        freeChain(chain);
         return;
     }
     // for || don't run if the previous chain succeeded
     if (activeOperator == AO_OR_OPERATOR && status != NULL && *status == 0) {
-        freeChain(chain);
         return;
     }
+    long long start = startProfileSpan();
+    // commands that read stdin continue the script where the parser is
+    int readsInput = chainReadsInput(chain);
+    if (readsInput) {
+        releaseLexerInput();
+    }
     // run the process in the background
     if (futureOperator == AO_AND_STATEMENT) {
-        // set the signal handler for the child processes
-        struct sigaction sigchild;
-        sigemptyset(&sigchild.sa_mask);
-        sigchild.sa_flags = SA_RESTART;
-        sigchild.sa_handler = &sigChildHandler;
-        sigaction(SIGCHLD, &sigchild, NULL);
-
-        // fork the program to run the chain in the background
+        // collect finished jobs first, so scripts that start many jobs do not pile up zombies
+        reapChildren();
+
+        // a fan-out starts its workers as jobs of the shell itself
+        if (chain->BuiltInCommand != NULL && chain->BuiltInCommand->builtInCommand == BIC_FANOUT) {
+            runFanout(chain->BuiltInCommand, 1);
+            if (readsInput) {
+                reclaimLexerInput();
+            }
+            endProfileSpan(PF_CHAIN, start, "&");
+            return;
+        }
+
+        // a plain pipeline is started directly, its stages form one process group
+        if (startsInBackground(chain)) {
+            runPipeline(chain, 1);
+            if (readsInput) {
+                reclaimLexerInput();
+            }
+            endProfileSpan(PF_CHAIN, start, "&");
+            return;
+        }
+
+        // fork the program to run the chain in the background, in a process group with its commands
         pid_t pid = fork();
         if (pid < 0) {
             printColor("\033[0;31m", "Error: fork() could not create a child process!\n");
-            freeChain(chain);
             exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
         } else if (pid == 0) {
-            // reset the signal handler for the child processes
-            struct sigaction sigchild;
-            sigemptyset(&sigchild.sa_mask);
-            sigchild.sa_flags = SA_RESTART;
-            sigchild.sa_handler = SIG_DFL;
-            sigaction(SIGCHLD, &sigchild, NULL);
+            // the job waits for its own commands, it does not collect the shell's
+            finalizeChildReaper();
+            setpgid(0, 0);
+            inBackgroundJob = 1;
+            // the job cannot read the terminal from its own group, commands without < read nothing
+            int devNull = open("/dev/null", O_RDONLY);
+            if (devNull >= 0) {
+                dup2(devNull, STDIN_FILENO);
+                close(devNull);
+            }
 
             // reset the int signal handler for the child processes
             struct sigaction sigint;
@@ -609,32 +1003,30 @@ void runChain(Chain *chain) {
             sigaction(SIGINT, &sigint, NULL);
 
             runChainComponent(chain);
-            exit(EXIT_SUCCESS); /* EXIT_SUCCESS because we use Themis */
+            // the status of the job is the status of its chain
+            exit(*status);
         } else {
-            // add the process to the background list
-            addBackgroundProcess(backgroundList, pid);
-            freeChain(chain);
+            // add the process to the background list, the group is set from both sides so kill can reach it at once
+            setpgid(pid, pid);
+            char *commandLine = formatChain(chain);
+            addBackgroundJob(backgroundList, &pid, 1, 0, pid, commandLine);
+            free(commandLine);
+            if (readsInput) {
+                reclaimLexerInput();
+            }
+            endProfileSpan(PF_CHAIN, start, "&");
             return;
         }
     }
     // run the chain in the foreground
     runChainComponent(chain);
+    if (readsInput) {
+        reclaimLexerInput();
+    }
+    endProfileSpan(PF_CHAIN, start, NULL);
 }
 
+// release the parse tree of the current input line
 void freeError() {
-    if (lastChain != NULL) {
-        freeChain(lastChain);
-    }
-    if (lastPipeline != NULL) {
-        freePipeline(lastPipeline);
-    }
-    if (lastRedirections != NULL) {
-        freeRedirections(lastRedirections);
-    }
-    if (lastCommand != NULL) {
-        freeCommand(lastCommand);
-    }
-    if (lastArgs != NULL) {
-        freeArgs(lastArgs);
-    }
+    resetArena(parseArena);
 }
\ No newline at end of file
@@ -3,6 +3,25 @@
 
 #include "structs.h"
 
+// structure for a built-in pipeline stage that runs in the shell
+typedef struct BuiltInStage {
+    Command *command;
+    int output;
+    int error;
+    int status;
+} BuiltInStage;
+
+// structure for the opened files of the redirections of a pipeline
+typedef struct RedirectionFiles {
+    int *input;
+    int *output;
+    int *error;
+    // the written files the shell made, they are removed again if the redirections conflict
+    char **created;
+    int numCreated;
+} RedirectionFiles;
+
+int chainReadsInput(Chain *chain);
 void runChain(Chain *chain);
 void freeError();
 void sigIntHandler(int signo);
@@ -0,0 +1,700 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "utility.h"
+
+extern int *status;
+
+// Small utilities that scripts run all the time are run by the shell itself instead of
+// being started as programs. Their output is the same as that of GNU coreutils; for
+// arguments where it could differ (help, warnings, errors, locales) the program is run.
+
+// structure for the output of a utility, it is written at once when the utility is done
+typedef struct UtilityOutput {
+    char *data;
+    size_t length;
+    size_t capacity;
+    // whether the arguments are only checked, nothing is written and no files are tested
+    int checking;
+    // whether \c ended the output
+    int stopped;
+} UtilityOutput;
+
+// find the utility that a command name runs
+BuiltInCommand findUtility(char *commandName) {
+    if (strcmp(commandName, "echo") == 0) {
+        return BIC_ECHO;
+    }
+    if (strcmp(commandName, "true") == 0) {
+        return BIC_TRUE;
+    }
+    if (strcmp(commandName, "false") == 0) {
+        return BIC_FALSE;
+    }
+    if (strcmp(commandName, "test") == 0 || strcmp(commandName, "[") == 0) {
+        return BIC_TEST;
+    }
+    if (strcmp(commandName, "printf") == 0) {
+        return BIC_PRINTF;
+    }
+    return BIC_NONE;
+}
+
+// check if a built-in command is a utility, which keeps its name as the first argument
+int isUtility(BuiltInCommand builtInCommand) {
+    switch (builtInCommand) {
+        case BIC_ECHO:
+        case BIC_TRUE:
+        case BIC_FALSE:
+        case BIC_TEST:
+        case BIC_PRINTF:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// make room for more bytes in the output
+void reserveOutput(UtilityOutput *output, size_t length) {
+    if (output->length + length > output->capacity) {
+        output->capacity = output->capacity == 0 ? 256 : output->capacity;
+        while (output->length + length > output->capacity) {
+            output->capacity *= 2;
+        }
+        output->data = realloc(output->data, output->capacity);
+    }
+}
+
+// add bytes to the output
+void appendOutput(UtilityOutput *output, char *data, size_t length) {
+    if (output->checking) {
+        return;
+    }
+    reserveOutput(output, length);
+    memcpy(output->data + output->length, data, length);
+    output->length += length;
+}
+
+// add one byte to the output
+void appendByte(UtilityOutput *output, unsigned char byte) {
+    appendOutput(output, (char *) &byte, 1);
+}
+
+// add formatted text to the output, printed by the same printf the programs use
+void appendPrintf(UtilityOutput *output, char *format, ...) {
+    if (output->checking) {
+        return;
+    }
+    va_list list;
+    va_start(list, format);
+    int length = vsnprintf(NULL, 0, format, list);
+    va_end(list);
+    // room for the terminating zero of vsnprintf, which is not part of the output
+    reserveOutput(output, length + 1);
+    va_start(list, format);
+    vsnprintf(output->data + output->length, length + 1, format, list);
+    va_end(list);
+    output->length += length;
+}
+
+// get the value of a hexadecimal digit
+int hexValue(char digit) {
+    return isdigit((unsigned char) digit) ? digit - '0' : tolower((unsigned char) digit) - 'a' + 10;
+}
+
+// get the character of a single letter escape
+unsigned char escapedCharacter(char letter) {
+    switch (letter) {
+        case 'a': return '\a';
+        case 'b': return '\b';
+        case 'e': return '\x1B';
+        case 'f': return '\f';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 't': return '\t';
+        case 'v': return '\v';
+        default: return letter;
+    }
+}
+
+// check if an argument of echo only consists of options
+int isEchoOptions(char *arg) {
+    if (arg[0] != '-' || arg[1] == '\0') {
+        return 0;
+    }
+    for (char *c = arg + 1; *c != '\0'; c++) {
+        if (*c != 'n' && *c != 'e' && *c != 'E') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// write an argument of echo -e, returns 0 if \c ended the output
+int appendEchoEscapes(UtilityOutput *output, char *arg) {
+    unsigned char c;
+    char *s = arg;
+    while ((c = *s++) != '\0') {
+        if (c == '\\' && *s != '\0') {
+            switch (c = *s++) {
+                case 'c':
+                    return 0;
+                case 'x':
+                    // without a hexadecimal digit it is not an escape
+                    if (!isxdigit((unsigned char) *s)) {
+                        appendByte(output, '\\');
+                        break;
+                    }
+                    c = hexValue(*s++);
+                    if (isxdigit((unsigned char) *s)) {
+                        c = c * 16 + hexValue(*s++);
+                    }
+                    break;
+                case '0':
+                    // \0 is followed by up to three octal digits
+                    c = 0;
+                    if (*s < '0' || *s > '7') {
+                        break;
+                    }
+                    c = *s++;
+                    // fall through
+                case '1': case '2': case '3':
+                case '4': case '5': case '6': case '7':
+                    c -= '0';
+                    if (*s >= '0' && *s <= '7') {
+                        c = c * 8 + (*s++ - '0');
+                    }
+                    if (*s >= '0' && *s <= '7') {
+                        c = c * 8 + (*s++ - '0');
+                    }
+                    break;
+                case 'a': case 'b': case 'e': case 'f':
+                case 'n': case 'r': case 't': case 'v':
+                    c = escapedCharacter(c);
+                    break;
+                case '\\':
+                    break;
+                default:
+                    appendByte(output, '\\');
+                    break;
+            }
+        }
+        appendByte(output, c);
+    }
+    return 1;
+}
+
+// run echo, which takes -n, -e and -E in any combination before its words
+int runEcho(char **args, int numArgs, UtilityOutput *output) {
+    // POSIXLY_CORRECT changes the options of echo
+    if (getenv("POSIXLY_CORRECT") != NULL) {
+        return -1;
+    }
+    if (numArgs == 2 && (strcmp(args[1], "--help") == 0 || strcmp(args[1], "--version") == 0)) {
+        return -1;
+    }
+    int newline = 1;
+    int escapes = 0;
+    int i = 1;
+    for (; i < numArgs && isEchoOptions(args[i]); i++) {
+        for (char *c = args[i] + 1; *c != '\0'; c++) {
+            newline = *c == 'n' ? 0 : newline;
+            escapes = *c == 'e' ? 1 : *c == 'E' ? 0 : escapes;
+        }
+    }
+    for (; i < numArgs; i++) {
+        if (!escapes) {
+            appendOutput(output, args[i], strlen(args[i]));
+        } else if (!appendEchoEscapes(output, args[i])) {
+            return 0;
+        }
+        if (i < numArgs - 1) {
+            appendByte(output, ' ');
+        }
+    }
+    if (newline) {
+        appendByte(output, '\n');
+    }
+    return 0;
+}
+
+// run true or false, which only have --help and --version
+int runTrueFalse(char **args, int numArgs, int exitStatus) {
+    if (numArgs == 2 && (strcmp(args[1], "--help") == 0 || strcmp(args[1], "--version") == 0)) {
+        return -1;
+    }
+    return exitStatus;
+}
+
+// read an integer of test: blanks, a sign and digits, returns 0 if test would fail or it is too long
+int parseTestInteger(char *arg, long long *value) {
+    char *p = arg;
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    int negative = *p == '-';
+    if (*p == '+' || *p == '-') {
+        p++;
+    }
+    if (!isdigit((unsigned char) *p)) {
+        return 0;
+    }
+    *value = 0;
+    for (int digits = 0; isdigit((unsigned char) *p); digits++, p++) {
+        if (digits == 18) {
+            return 0;
+        }
+        *value = *value * 10 + (*p - '0');
+    }
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    *value = negative ? -*value : *value;
+    return *p == '\0';
+}
+
+// evaluate a unary operator of test, 1 if it is true, 0 if not and -1 if the shell does not run it
+int testUnary(char op, char *arg, int evaluate) {
+    struct stat info;
+    switch (op) {
+        case 'n':
+            return arg[0] != '\0';
+        case 'z':
+            return arg[0] == '\0';
+        case 'e': case 'f': case 'd': case 'b': case 'c': case 'p': case 'S':
+        case 'h': case 'L': case 's': case 'g': case 'u': case 'k':
+        case 'r': case 'w': case 'x': case 'O': case 'G': case 'N':
+            break;
+        default:
+            // -t looks at descriptors the shell does not share with the stage
+            return -1;
+    }
+    if (!evaluate) {
+        return 0;
+    }
+    switch (op) {
+        case 'h':
+        case 'L':
+            return lstat(arg, &info) == 0 && S_ISLNK(info.st_mode);
+        case 'r':
+            return euidaccess(arg, R_OK) == 0;
+        case 'w':
+            return euidaccess(arg, W_OK) == 0;
+        case 'x':
+            return euidaccess(arg, X_OK) == 0;
+    }
+    if (stat(arg, &info) != 0) {
+        return 0;
+    }
+    switch (op) {
+        case 'f': return S_ISREG(info.st_mode);
+        case 'd': return S_ISDIR(info.st_mode);
+        case 'b': return S_ISBLK(info.st_mode);
+        case 'c': return S_ISCHR(info.st_mode);
+        case 'p': return S_ISFIFO(info.st_mode);
+        case 'S': return S_ISSOCK(info.st_mode);
+        case 's': return info.st_size > 0;
+        case 'g': return (info.st_mode & S_ISGID) != 0;
+        case 'u': return (info.st_mode & S_ISUID) != 0;
+        case 'k': return (info.st_mode & S_ISVTX) != 0;
+        case 'O': return geteuid() == info.st_uid;
+        case 'G': return getegid() == info.st_gid;
+        case 'N':
+            return info.st_mtim.tv_sec > info.st_atim.tv_sec
+                || (info.st_mtim.tv_sec == info.st_atim.tv_sec && info.st_mtim.tv_nsec > info.st_atim.tv_nsec);
+        default: return 1;
+    }
+}
+
+// check if a word is a binary operator of test
+int isTestBinaryOperator(char *op) {
+    char *operators[] = { "=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", "-nt", "-ot", "-ef" };
+    for (int i = 0; i < (int) (sizeof(operators) / sizeof(char *)); i++) {
+        if (strcmp(op, operators[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// compare the modification times of two files, 0 if a file does not exist
+int compareModificationTimes(char *left, char *right, int *leftExists, int *rightExists) {
+    struct stat leftInfo, rightInfo;
+    *leftExists = stat(left, &leftInfo) == 0;
+    *rightExists = stat(right, &rightInfo) == 0;
+    if (!*leftExists || !*rightExists) {
+        return 0;
+    }
+    if (leftInfo.st_mtim.tv_sec != rightInfo.st_mtim.tv_sec) {
+        return leftInfo.st_mtim.tv_sec < rightInfo.st_mtim.tv_sec ? -1 : 1;
+    }
+    return (leftInfo.st_mtim.tv_nsec > rightInfo.st_mtim.tv_nsec) - (leftInfo.st_mtim.tv_nsec < rightInfo.st_mtim.tv_nsec);
+}
+
+// evaluate a binary operator of test
+int testBinary(char *left, char *op, char *right, int evaluate) {
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) {
+        return strcmp(left, right) == 0;
+    }
+    if (strcmp(op, "!=") == 0) {
+        return strcmp(left, right) != 0;
+    }
+    if (strcmp(op, "<") == 0 || strcmp(op, ">") == 0) {
+        // ordered by the collation of the locale
+        return -1;
+    }
+    if (strcmp(op, "-nt") == 0 || strcmp(op, "-ot") == 0 || strcmp(op, "-ef") == 0) {
+        if (!evaluate) {
+            return 0;
+        }
+        if (strcmp(op, "-ef") == 0) {
+            struct stat leftInfo, rightInfo;
+            return stat(left, &leftInfo) == 0 && stat(right, &rightInfo) == 0
+                && leftInfo.st_dev == rightInfo.st_dev && leftInfo.st_ino == rightInfo.st_ino;
+        }
+        int leftExists, rightExists;
+        int order = compareModificationTimes(left, right, &leftExists, &rightExists);
+        if (strcmp(op, "-nt") == 0) {
+            return leftExists && (!rightExists || order > 0);
+        }
+        return rightExists && (!leftExists || order < 0);
+    }
+    long long leftValue, rightValue;
+    if (!parseTestInteger(left, &leftValue) || !parseTestInteger(right, &rightValue)) {
+        return -1;
+    }
+    switch (op[2]) {
+        case 'q': return leftValue == rightValue;
+        case 'e': return op[1] == 'n' ? leftValue != rightValue : op[1] == 'l' ? leftValue <= rightValue : leftValue >= rightValue;
+        default: return op[1] == 'l' ? leftValue < rightValue : leftValue > rightValue;
+    }
+}
+
+// negate a result of test, unless the shell does not run it
+int negateTest(int result) {
+    return result < 0 ? result : !result;
+}
+
+// evaluate the arguments of test the way POSIX decides on them by their number, up to four
+int testArguments(char **args, int numArgs, int evaluate) {
+    switch (numArgs) {
+        case 0:
+            return 0;
+        case 1:
+            return args[0][0] != '\0';
+        case 2:
+            if (strcmp(args[0], "!") == 0) {
+                return negateTest(testArguments(args + 1, 1, evaluate));
+            }
+            if (args[0][0] == '-' && args[0][1] != '\0' && args[0][2] == '\0') {
+                return testUnary(args[0][1], args[1], evaluate);
+            }
+            return -1;
+        case 3:
+            if (isTestBinaryOperator(args[1])) {
+                return testBinary(args[0], args[1], args[2], evaluate);
+            }
+            if (strcmp(args[0], "!") == 0) {
+                return negateTest(testArguments(args + 1, 2, evaluate));
+            }
+            if (strcmp(args[0], "(") == 0 && strcmp(args[2], ")") == 0) {
+                return testArguments(args + 1, 1, evaluate);
+            }
+            // -a and -o go through the full expression grammar
+            return -1;
+        case 4:
+            if (strcmp(args[0], "!") == 0) {
+                return negateTest(testArguments(args + 1, 3, evaluate));
+            }
+            if (strcmp(args[0], "(") == 0 && strcmp(args[3], ")") == 0) {
+                return testArguments(args + 1, 2, evaluate);
+            }
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+// run test or [, which needs ] as its last argument
+int runTest(char **args, int numArgs, UtilityOutput *output) {
+    if (strcmp(args[0], "[") == 0) {
+        if (numArgs == 2 && (strcmp(args[1], "--help") == 0 || strcmp(args[1], "--version") == 0)) {
+            return -1;
+        }
+        if (numArgs < 2 || strcmp(args[numArgs - 1], "]") != 0) {
+            return -1;
+        }
+        numArgs--;
+    }
+    int result = testArguments(args + 1, numArgs - 1, !output->checking);
+    return result < 0 ? -1 : !result;
+}
+
+// write an escape of printf after its backslash, returns the length of the escape or -1 if the shell does not run it;
+// in the arguments of %b an octal escape starts with \0
+int appendPrintfEscape(UtilityOutput *output, char *escape, int octalZero) {
+    char *p = escape;
+    unsigned char value = 0;
+    int length;
+    if (*p == 'x') {
+        for (length = 0, p++; length < 2 && isxdigit((unsigned char) *p); length++, p++) {
+            value = value * 16 + hexValue(*p);
+        }
+        if (length == 0) {
+            return -1;
+        }
+        appendByte(output, value);
+    } else if (*p >= '0' && *p <= '7') {
+        if (octalZero && *p == '0') {
+            p++;
+        }
+        for (length = 0; length < 3 && *p >= '0' && *p <= '7'; length++, p++) {
+            value = value * 8 + (*p - '0');
+        }
+        appendByte(output, value);
+    } else if (*p != '\0' && strchr("\"\\abcefnrtv", *p) != NULL) {
+        if (*p == 'c') {
+            output->stopped = 1;
+        } else {
+            appendByte(output, escapedCharacter(*p));
+        }
+        p++;
+    } else if (*p == 'u' || *p == 'U') {
+        // unicode escapes depend on the locale
+        return -1;
+    } else {
+        appendByte(output, '\\');
+        if (*p != '\0') {
+            appendByte(output, *p);
+            p++;
+        }
+    }
+    return p - escape;
+}
+
+// write an argument of %b
+int appendEscapedArgument(UtilityOutput *output, char *arg) {
+    for (char *s = arg; *s != '\0' && !output->stopped; s++) {
+        if (*s != '\\') {
+            appendByte(output, *s);
+            continue;
+        }
+        int length = appendPrintfEscape(output, s + 1, 1);
+        if (length < 0) {
+            return 0;
+        }
+        s += length;
+    }
+    return 1;
+}
+
+// read a numeric argument of printf, a quote followed by a character is the value of the character;
+// returns 0 if printf would warn about it
+int parsePrintfNumber(char *arg, int isSigned, long long *value) {
+    if ((arg[0] == '"' || arg[0] == '\'') && arg[1] != '\0') {
+        // characters outside ASCII depend on the locale
+        if ((unsigned char) arg[1] >= 0x80 || arg[2] != '\0') {
+            return 0;
+        }
+        *value = (unsigned char) arg[1];
+        return 1;
+    }
+    char *end;
+    errno = 0;
+    *value = isSigned ? strtoll(arg, &end, 0) : (long long) strtoull(arg, &end, 0);
+    return errno == 0 && *end == '\0';
+}
+
+// write a directive of printf, f points after the %; returns the length of the directive or -1 if the shell does not run it
+int appendDirective(UtilityOutput *output, char *f, char *arg) {
+    char *p = f;
+    int alternate = 0, zero = 0, precision = 0;
+    while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+        alternate |= *p == '#';
+        zero |= *p == '0';
+        p++;
+    }
+    // the width and precision are copied into the directive, a * is not a digit or a conversion, so
+    // a directive that takes them from the arguments is left to the printf program
+    for (int digits = 0; isdigit((unsigned char) *p); digits++, p++) {
+        if (digits == 6) {
+            return -1;
+        }
+    }
+    if (*p == '.') {
+        precision = 1;
+        p++;
+        for (int digits = 0; isdigit((unsigned char) *p); digits++, p++) {
+            if (digits == 6) {
+                return -1;
+            }
+        }
+    }
+    char *modifiers = p;
+    if (modifiers - f > 20) {
+        return -1;
+    }
+    while (*p != '\0' && strchr("hlLjzt", *p) != NULL) {
+        p++;
+    }
+    char conversion = *p;
+    if (conversion == '\0' || strchr("diouxXsc", conversion) == NULL) {
+        return -1;
+    }
+    if ((alternate && strchr("cdisu", conversion) != NULL) || (zero && strchr("cs", conversion) != NULL) || (precision && conversion == 'c')) {
+        return -1;
+    }
+
+    // the directive with the length modifiers of the shell
+    char directive[32];
+    int length = modifiers - f;
+    directive[0] = '%';
+    memcpy(directive + 1, f, length);
+    length++;
+    if (conversion == 's' || conversion == 'c') {
+        directive[length++] = conversion;
+        directive[length] = '\0';
+        if (conversion == 's') {
+            appendPrintf(output, directive, arg);
+        } else {
+            appendPrintf(output, directive, arg[0]);
+        }
+        return p + 1 - f;
+    }
+    directive[length++] = 'l';
+    directive[length++] = 'l';
+    directive[length++] = conversion;
+    directive[length] = '\0';
+    long long value;
+    if (!parsePrintfNumber(arg, conversion == 'd' || conversion == 'i', &value)) {
+        return -1;
+    }
+    if (conversion == 'd' || conversion == 'i') {
+        appendPrintf(output, directive, value);
+    } else {
+        appendPrintf(output, directive, (unsigned long long) value);
+    }
+    return p + 1 - f;
+}
+
+// write the format once, returns the number of arguments it used or -1 if the shell does not run it
+int appendFormat(UtilityOutput *output, char *format, char **args, int numArgs) {
+    int used = 0;
+    for (char *f = format; *f != '\0' && !output->stopped; f++) {
+        if (*f == '\\') {
+            int length = appendPrintfEscape(output, f + 1, 0);
+            if (length < 0) {
+                return -1;
+            }
+            f += length;
+            continue;
+        }
+        if (*f != '%') {
+            appendByte(output, *f);
+            continue;
+        }
+        f++;
+        if (*f == '%') {
+            appendByte(output, '%');
+            continue;
+        }
+        // a missing argument is an empty string, or 0 for numbers
+        char *arg = used < numArgs ? args[used] : "";
+        int length;
+        if (*f == 'b') {
+            length = appendEscapedArgument(output, arg) ? 1 : -1;
+        } else {
+            length = appendDirective(output, f, arg);
+        }
+        if (length < 0) {
+            return -1;
+        }
+        f += length - 1;
+        if (used < numArgs) {
+            used++;
+        }
+    }
+    return used;
+}
+
+// run printf, the format is repeated until all arguments are used
+int runPrintf(char **args, int numArgs, UtilityOutput *output) {
+    if (numArgs == 2 && (strcmp(args[1], "--help") == 0 || strcmp(args[1], "--version") == 0)) {
+        return -1;
+    }
+    args++;
+    numArgs--;
+    if (numArgs > 0 && strcmp(args[0], "--") == 0) {
+        args++;
+        numArgs--;
+    }
+    if (numArgs == 0) {
+        return -1;
+    }
+    char *format = args[0];
+    args++;
+    numArgs--;
+    do {
+        int used = appendFormat(output, format, args, numArgs);
+        // arguments that are never used are warned about, unless \c ended the output
+        if (used < 0 || (used == 0 && numArgs > 0 && !output->stopped)) {
+            return -1;
+        }
+        args += used;
+        numArgs -= used;
+    } while (numArgs > 0 && !output->stopped);
+    return 0;
+}
+
+// run a utility into its output, returns its exit status or -1 if the program has to run instead
+int runUtilityInto(Command *command, UtilityOutput *output) {
+    char **args = command->commandArgs->args;
+    int numArgs = command->commandArgs->numArgs;
+    switch (command->builtInCommand) {
+        case BIC_ECHO:
+            return runEcho(args, numArgs, output);
+        case BIC_TRUE:
+            return runTrueFalse(args, numArgs, 0);
+        case BIC_FALSE:
+            return runTrueFalse(args, numArgs, 1);
+        case BIC_TEST:
+            return runTest(args, numArgs, output);
+        case BIC_PRINTF:
+            return runPrintf(args, numArgs, output);
+        default:
+            return -1;
+    }
+}
+
+// check if the shell gives the same result as the program for these arguments, otherwise the program is run
+int canRunUtility(Command *command) {
+    UtilityOutput output = { NULL, 0, 0, 1, 0 };
+    return runUtilityInto(command, &output) >= 0;
+}
+
+// run a utility in the shell and write its output to stdout
+void runUtility(Command *command) {
+    UtilityOutput output = { NULL, 0, 0, 0, 0 };
+    int result = runUtilityInto(command, &output);
+    *status = result < 0 ? 2 : result;
+    for (size_t written = 0; written < output.length; ) {
+        ssize_t len = write(STDOUT_FILENO, output.data + written, output.length - written);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len < 0) {
+            // like the programs, a utility that cannot write fails
+            *status = 1;
+            break;
+        }
+        written += len;
+    }
+    free(output.data);
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef UTILITY_H
+#define UTILITY_H
+
+#include "structs.h"
+
+BuiltInCommand findUtility(char *commandName);
+int isUtility(BuiltInCommand builtInCommand);
+int canRunUtility(Command *command);
+void runUtility(Command *command);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "workdir.h"
+
+// replace the path with the one the kernel reports
+void refreshWorkingDirectory(WorkingDirectory *directory) {
+    char *path = getcwd(NULL, 0);
+    if (path == NULL) {
+        return;
+    }
+    free(directory->path);
+    directory->path = path;
+    directory->length = strlen(path);
+}
+
+// create the working directory from the current directory of the process
+WorkingDirectory *createWorkingDirectory() {
+    WorkingDirectory *directory = malloc(sizeof(WorkingDirectory));
+    directory->path = strdup("/");
+    directory->length = 1;
+    refreshWorkingDirectory(directory);
+    return directory;
+}
+
+// check if a path names the current directory of the process
+int isCurrentDirectory(char *path) {
+    struct stat pathInfo, currentInfo;
+    if (stat(path, &pathInfo) != 0 || stat(".", &currentInfo) != 0) {
+        return 0;
+    }
+    return pathInfo.st_dev == currentInfo.st_dev && pathInfo.st_ino == currentInfo.st_ino;
+}
+
+// change to a directory and work out the new path from the old one, without asking the kernel
+int changeWorkingDirectory(WorkingDirectory *directory, char *target) {
+    if (chdir(target) != 0) {
+        return -1;
+    }
+    int targetLength = strlen(target);
+    char *path = malloc(directory->length + targetLength + 2);
+    int length = 0;
+    if (target[0] != '/') {
+        memcpy(path, directory->path, directory->length);
+        length = directory->length;
+    }
+    // .. follows the path rather than the symlinks, which is checked below
+    int hasParent = 0;
+    char *component = target;
+    while (*component != '\0') {
+        while (*component == '/') {
+            component++;
+        }
+        char *end = component;
+        while (*end != '\0' && *end != '/') {
+            end++;
+        }
+        int componentLength = end - component;
+        if (componentLength == 2 && component[0] == '.' && component[1] == '.') {
+            while (length > 0 && path[length - 1] != '/') {
+                length--;
+            }
+            if (length > 1) {
+                length--;
+            }
+            hasParent = 1;
+        } else if (componentLength > 0 && !(componentLength == 1 && component[0] == '.')) {
+            if (length == 0 || path[length - 1] != '/') {
+                path[length++] = '/';
+            }
+            memcpy(path + length, component, componentLength);
+            length += componentLength;
+        }
+        component = end;
+    }
+    if (length == 0) {
+        path[length++] = '/';
+    }
+    path[length] = '\0';
+
+    free(directory->path);
+    directory->path = path;
+    directory->length = length;
+    if (hasParent && !isCurrentDirectory(path)) {
+        refreshWorkingDirectory(directory);
+    }
+    return 0;
+}
+
+// go back to a directory of the stack through its descriptor
+int returnToWorkingDirectory(WorkingDirectory *directory, int fd, char *path) {
+    // a directory that was removed while it was on the stack is not entered
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_nlink == 0 || fchdir(fd) != 0) {
+        return -1;
+    }
+    free(directory->path);
+    directory->length = strlen(path);
+    directory->path = malloc(directory->length + 1);
+    memcpy(directory->path, path, directory->length + 1);
+    return 0;
+}
+
+// free the working directory
+void freeWorkingDirectory(WorkingDirectory *directory) {
+    free(directory->path);
+    free(directory);
+}
\ No newline at end of file
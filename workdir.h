@@ -0,0 +1,15 @@
+#ifndef WORKDIR_H
+#define WORKDIR_H
+
+// structure for the working directory of the shell, kept as the path the user navigated
+typedef struct WorkingDirectory {
+    char *path;
+    int length;
+} WorkingDirectory;
+
+WorkingDirectory *createWorkingDirectory();
+int changeWorkingDirectory(WorkingDirectory *directory, char *target);
+int returnToWorkingDirectory(WorkingDirectory *directory, int fd, char *path);
+void freeWorkingDirectory(WorkingDirectory *directory);
+
+#endif
\ No newline at end of file